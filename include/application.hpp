@@ -1,20 +1,37 @@
 #pragma once
 
+#include "settings.hpp"
 #include <serverpp/core.hpp>
 #include <boost/asio/io_context.hpp>
+#include <functional>
 #include <memory>
+#include <vector>
 
 namespace textray {
 
 //* =========================================================================
 /// \brief A class that implements the main engine for the server.
 /// \param port - The server will be set up on this port identifier.
+/// \param config - Settings that govern the behaviour of each client.
 //* =========================================================================
 class application final  // NOLINT
 {
  public:
   application(
-      boost::asio::io_context &io_context, serverpp::port_identifier port);
+      boost::asio::io_context &io_context,
+      serverpp::port_identifier port,
+      settings config = {});
+
+  //* =====================================================================
+  /// \brief Constructs a sharded server, in which each of the passed
+  /// io_contexts listens on the same port (using SO_REUSEPORT).  Each
+  /// client is then pinned to the io_context that accepted it.
+  //* =====================================================================
+  application(
+      std::vector<std::reference_wrapper<boost::asio::io_context>> const
+          &io_contexts,
+      serverpp::port_identifier port,
+      settings config = {});
   ~application();
 
   void shutdown();
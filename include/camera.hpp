@@ -1,13 +1,35 @@
 #pragma once
 
+#include "colour_depth.hpp"
 #include "floorplan.hpp"
+#include "lightmap.hpp"
+#include "render.hpp"
+#include "render_mode.hpp"
+#include "render_precision.hpp"
+#include "shade_table.hpp"
 #include "vector2d.hpp"
+#include <terminalpp/string.hpp>
 #include <munin/basic_component.hpp>
 #include <munin/image.hpp>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <vector>
 
 namespace textray {
 
+struct client_metrics;
+
+//* =========================================================================
+/// \brief A frame of a camera's view, rendered away from the thread that
+/// draws the camera.
+//* =========================================================================
+struct camera_frame
+{
+  terminalpp::extent size;
+  std::vector<terminalpp::string> content;
+};
+
 class camera : public munin::basic_component
 {
  public:
@@ -33,6 +55,72 @@ class camera : public munin::basic_component
   //* =====================================================================
   void set_fov(double fov);
 
+  //* =====================================================================
+  /// \brief Set the colour depth to which the rendered image is
+  /// quantised.
+  //* =====================================================================
+  void set_colour_depth(colour_depth depth);
+
+  //* =====================================================================
+  /// \brief Set the number of bands into which wall, floor and ceiling
+  /// shading is quantised, or 0 for continuous shading.  Fewer bands
+  /// produce longer runs of identical attributes, and therefore fewer
+  /// bytes per frame.
+  //* =====================================================================
+  void set_shade_bands(int bands);
+
+  //* =====================================================================
+  /// \brief Set the way in which the view is mapped onto cells.
+  //* =====================================================================
+  void set_render_mode(render_mode mode);
+
+  //* =====================================================================
+  /// \brief Set the precision in which the view's rays are cast.
+  //* =====================================================================
+  void set_render_precision(render_precision precision);
+
+  //* =====================================================================
+  /// \brief Set the interval at which columns of rays are cast before
+  /// those between them are refined.  See render_options::column_stride.
+  //* =====================================================================
+  void set_column_stride(int stride);
+
+  //* =====================================================================
+  /// \brief Set the static lighting of the camera's floorplan, or null to
+  /// shade its walls by distance alone.
+  //* =====================================================================
+  void set_lighting(std::shared_ptr<lightmap const> lighting);
+
+  //* =====================================================================
+  /// \brief Set whether the walls are taken from a panorama cast at the
+  /// camera's position, so that turning on the spot casts no rays.
+  //* =====================================================================
+  void set_panorama_enabled(bool enabled);
+
+  //* =====================================================================
+  /// \brief Set the metrics in which the time taken to render each frame
+  /// is recorded.
+  //* =====================================================================
+  void set_metrics(std::shared_ptr<client_metrics> metrics);
+
+  //* =====================================================================
+  /// \brief Returns a function that renders the camera's current view,
+  /// and that may be called on any thread.  It renders from a snapshot
+  /// of the camera's state, which the camera may go on changing, except
+  /// for the panorama that the camera keeps between frames.  At most one
+  /// such function may therefore be running at a time, and never while
+  /// the camera is being drawn.
+  //* =====================================================================
+  [[nodiscard]] std::function<camera_frame()> prepare_frame() const;
+
+  //* =====================================================================
+  /// \brief Sets a frame rendered by a function from prepare_frame() to
+  /// be drawn the next time that the camera is drawn, instead of one
+  /// rendered then.  A frame that is no longer the size of the camera by
+  /// then is discarded.
+  //* =====================================================================
+  void set_frame(camera_frame frame);
+
  private:
   //* =====================================================================
   /// \brief Called by get_preferred_size().  Derived classes must override
@@ -56,11 +144,21 @@ class camera : public munin::basic_component
 
   void do_set_size(terminalpp::extent const &size) override;
 
+  void build_shade_table(colour_depth depth, int bands);
+
   std::shared_ptr<munin::image> image_;
   std::shared_ptr<floorplan> floorplan_;
   vector2d position_;
   double heading_;
   double fov_;
+  std::shared_ptr<shade_table const> shades_;
+  render_options options_;
+  std::shared_ptr<floorplan_summary const> summary_;
+  std::shared_ptr<lightmap const> lighting_;
+  bool panorama_enabled_{false};
+  std::shared_ptr<panorama> panorama_;
+  std::shared_ptr<client_metrics> metrics_;
+  mutable std::optional<camera_frame> frame_;
 };
 
 }  // namespace textray
@@ -6,16 +6,24 @@
 namespace textray {
 
 class connection;
+class frame_scheduler;
+struct client_metrics;
+struct settings;
 
 class client  // NOLINT
 {
  public:
   //* =====================================================================
   /// \brief Constructor
+  /// \param scheduler the scheduler that renders the client's frames, or
+  /// null to render them on the client's strand.
   //* =====================================================================
   explicit client(
       connection &&cnx,
       boost::asio::io_context &io_context,
+      frame_scheduler *scheduler,
+      settings const &config,
+      std::shared_ptr<client_metrics> metrics,
       std::function<void(client const &)> const &connection_died,
       std::function<void()> const &shutdown);
 
@@ -30,8 +38,11 @@ class client  // NOLINT
   void close();
 
  private:
+  // The implementation is shared with the handlers that it has posted, so
+  // that any that are still pending when the client is destroyed can
+  // detect that and do nothing.
   class impl;
-  std::unique_ptr<impl> pimpl_;
+  std::shared_ptr<impl> pimpl_;
 };
 
 }  // namespace textray
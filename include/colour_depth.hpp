@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string_view>
+
+namespace textray {
+
+//* =========================================================================
+/// \brief The range of colours that a client's terminal is able to
+/// display.
+//* =========================================================================
+enum class colour_depth
+{
+  true_colour,  // 24-bit RGB
+  high_colour,  // 256-colour palette
+  low_colour,   // 16-colour palette (8 colours plus bold)
+  greyscale,    // the 24-step greyscale ramp of the 256-colour palette
+};
+
+//* =========================================================================
+/// \brief Returns a colour depth appropriate for the terminal type reported
+/// by the client (e.g. via the Telnet TTYPE option).  Terminal types that
+/// are not recognised are assumed to support the 256-colour palette.
+//* =========================================================================
+colour_depth colour_depth_for_terminal_type(std::string_view terminal_type);
+
+//* =========================================================================
+/// \brief Returns the next colour depth in sequence, wrapping around.  This
+/// is useful to allow users to cycle through the available depths.
+//* =========================================================================
+colour_depth next_colour_depth(colour_depth depth);
+
+}  // namespace textray
@@ -3,6 +3,7 @@
 #include <serverpp/core.hpp>
 #include <functional>
 #include <memory>
+#include <string>
 
 namespace serverpp {
 class tcp_socket;
@@ -10,6 +11,44 @@ class tcp_socket;
 
 namespace textray {
 
+struct client_metrics;
+
+//* =========================================================================
+/// \brief The means by which a connection communicates with its peer.
+/// See the connection class for a description of each function.
+//* =========================================================================
+class connection_endpoint
+{
+ public:
+  virtual ~connection_endpoint() = default;
+
+  [[nodiscard]] virtual bool is_alive() const = 0;
+
+  virtual void close() = 0;
+
+  virtual void async_read(
+      std::function<void(serverpp::bytes)> const &data_continuation,
+      std::function<void()> const &read_complete_continuation) = 0;
+
+  virtual void write(serverpp::bytes data) = 0;
+
+  virtual void async_get_terminal_type(
+      std::function<void(std::string const &)> const &continuation) = 0;
+
+  virtual void on_window_size_changed(
+      std::function<void(std::uint16_t, std::uint16_t)> const
+          &continuation) = 0;
+
+  virtual void set_metrics(std::shared_ptr<client_metrics> metrics) = 0;
+};
+
+//* =========================================================================
+/// \brief Creates an endpoint that communicates over the passed socket
+/// using the Telnet protocol.
+//* =========================================================================
+std::unique_ptr<connection_endpoint> make_telnet_endpoint(
+    serverpp::tcp_socket &&socket);
+
 //* =========================================================================
 /// \brief An connection to a socket that abstracts away details about the
 /// protocols used.
@@ -24,6 +63,12 @@ class connection  // NOLINT
   //* =====================================================================
   explicit connection(serverpp::tcp_socket &&socket);
 
+  //* =====================================================================
+  /// \brief Create a connection object that communicates through the
+  /// passed endpoint.
+  //* =====================================================================
+  explicit connection(std::unique_ptr<connection_endpoint> endpoint);
+
   //* =====================================================================
   /// \brief Move constructor
   //* =====================================================================
@@ -81,9 +126,14 @@ class connection  // NOLINT
   void on_window_size_changed(
       std::function<void(std::uint16_t, std::uint16_t)> const &continuation);
 
+  //* =====================================================================
+  /// \brief Set the metrics in which the bytes written to the connection
+  ///        are counted, both before and after compression.
+  //* =====================================================================
+  void set_metrics(std::shared_ptr<client_metrics> metrics);
+
  private:
-  struct impl;
-  std::unique_ptr<impl> pimpl_;
+  std::unique_ptr<connection_endpoint> pimpl_;
 };
 
 }  // namespace textray
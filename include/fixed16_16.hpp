@@ -0,0 +1,246 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace textray {
+
+//* =========================================================================
+/// \brief A signed fixed-point number with 16 integral and 16 fractional
+/// bits.
+/// \par
+/// Arithmetic saturates rather than overflowing, so that, for example, the
+/// reciprocal of a very small number is merely very large.  This gives a
+/// range of about +/-32768 with a resolution of 1/65536, which is ample
+/// for distances on a floorplan and rows on a terminal.
+//* =========================================================================
+class fixed16_16
+{
+ public:
+  static constexpr int fractional_bits = 16;
+  static constexpr std::int64_t one = std::int64_t{1} << fractional_bits;
+
+  //* =====================================================================
+  /// \brief Default Constructor
+  /// \par
+  /// Constructs a fixed16_16 with the value zero.
+  //* =====================================================================
+  constexpr fixed16_16() = default;
+
+  //* =====================================================================
+  /// \brief Constructor from an integer.
+  //* =====================================================================
+  constexpr explicit fixed16_16(int value)
+    : raw_(saturate(std::int64_t{value} * one))
+  {
+  }
+
+  //* =====================================================================
+  /// \brief Constructor from a floating-point number, rounding to the
+  /// nearest representable value.
+  //* =====================================================================
+  explicit fixed16_16(double value)
+    : raw_(saturate(std::llround(value * static_cast<double>(one))))
+  {
+  }
+
+  //* =====================================================================
+  /// \brief Constructs a fixed16_16 from its raw representation, which is
+  /// its value multiplied by 65536.
+  //* =====================================================================
+  static constexpr fixed16_16 from_raw(std::int32_t raw)
+  {
+    fixed16_16 result;
+    result.raw_ = raw;
+    return result;
+  }
+
+  //* =====================================================================
+  /// \brief Returns the raw representation of the value.
+  //* =====================================================================
+  [[nodiscard]] constexpr std::int32_t raw() const
+  {
+    return raw_;
+  }
+
+  //* =====================================================================
+  /// \brief Conversion to double.
+  //* =====================================================================
+  constexpr explicit operator double() const
+  {
+    return static_cast<double>(raw_) / static_cast<double>(one);
+  }
+
+  //* =====================================================================
+  /// \brief Conversion to int, truncating towards zero.
+  //* =====================================================================
+  constexpr explicit operator int() const
+  {
+    return static_cast<int>(raw_ / one);
+  }
+
+  //* =====================================================================
+  /// \brief Addition
+  //* =====================================================================
+  constexpr fixed16_16 &operator+=(fixed16_16 const &rhs)
+  {
+    raw_ = saturate(std::int64_t{raw_} + rhs.raw_);
+    return *this;
+  }
+
+  //* =====================================================================
+  /// \brief Subtraction
+  //* =====================================================================
+  constexpr fixed16_16 &operator-=(fixed16_16 const &rhs)
+  {
+    raw_ = saturate(std::int64_t{raw_} - rhs.raw_);
+    return *this;
+  }
+
+  //* =====================================================================
+  /// \brief Multiplication
+  //* =====================================================================
+  constexpr fixed16_16 &operator*=(fixed16_16 const &rhs)
+  {
+    raw_ = saturate((std::int64_t{raw_} * rhs.raw_) / one);
+    return *this;
+  }
+
+  //* =====================================================================
+  /// \brief Division.  Division by zero saturates in the direction of
+  /// the dividend.
+  //* =====================================================================
+  constexpr fixed16_16 &operator/=(fixed16_16 const &rhs)
+  {
+    if (rhs.raw_ == 0)
+    {
+      raw_ = raw_ < 0 ? std::numeric_limits<std::int32_t>::min()
+                      : std::numeric_limits<std::int32_t>::max();
+    }
+    else
+    {
+      raw_ = saturate((std::int64_t{raw_} * one) / rhs.raw_);
+    }
+
+    return *this;
+  }
+
+ private:
+  static constexpr std::int32_t saturate(std::int64_t value)
+  {
+    return value < std::numeric_limits<std::int32_t>::min()
+               ? std::numeric_limits<std::int32_t>::min()
+           : value > std::numeric_limits<std::int32_t>::max()
+               ? std::numeric_limits<std::int32_t>::max()
+               : static_cast<std::int32_t>(value);
+  }
+
+  std::int32_t raw_{0};
+};
+
+// ==========================================================================
+// OPERATOR==(fixed16_16,fixed16_16)
+// ==========================================================================
+constexpr bool operator==(fixed16_16 const &lhs, fixed16_16 const &rhs)
+{
+  return lhs.raw() == rhs.raw();
+}
+
+// ==========================================================================
+// OPERATOR!=(fixed16_16,fixed16_16)
+// ==========================================================================
+constexpr bool operator!=(fixed16_16 const &lhs, fixed16_16 const &rhs)
+{
+  return !(lhs == rhs);
+}
+
+// ==========================================================================
+// OPERATOR<(fixed16_16,fixed16_16)
+// ==========================================================================
+constexpr bool operator<(fixed16_16 const &lhs, fixed16_16 const &rhs)
+{
+  return lhs.raw() < rhs.raw();
+}
+
+// ==========================================================================
+// OPERATOR>(fixed16_16,fixed16_16)
+// ==========================================================================
+constexpr bool operator>(fixed16_16 const &lhs, fixed16_16 const &rhs)
+{
+  return rhs < lhs;
+}
+
+// ==========================================================================
+// OPERATOR<=(fixed16_16,fixed16_16)
+// ==========================================================================
+constexpr bool operator<=(fixed16_16 const &lhs, fixed16_16 const &rhs)
+{
+  return !(rhs < lhs);
+}
+
+// ==========================================================================
+// OPERATOR>=(fixed16_16,fixed16_16)
+// ==========================================================================
+constexpr bool operator>=(fixed16_16 const &lhs, fixed16_16 const &rhs)
+{
+  return !(lhs < rhs);
+}
+
+// ==========================================================================
+// OPERATOR-(fixed16_16)
+// ==========================================================================
+constexpr fixed16_16 operator-(fixed16_16 const &value)
+{
+  return fixed16_16{} -= value;
+}
+
+// ==========================================================================
+// OPERATOR+(fixed16_16,fixed16_16)
+// ==========================================================================
+constexpr fixed16_16 operator+(fixed16_16 lhs, fixed16_16 const &rhs)
+{
+  return lhs += rhs;
+}
+
+// ==========================================================================
+// OPERATOR-(fixed16_16,fixed16_16)
+// ==========================================================================
+constexpr fixed16_16 operator-(fixed16_16 lhs, fixed16_16 const &rhs)
+{
+  return lhs -= rhs;
+}
+
+// ==========================================================================
+// OPERATOR*(fixed16_16,fixed16_16)
+// ==========================================================================
+constexpr fixed16_16 operator*(fixed16_16 lhs, fixed16_16 const &rhs)
+{
+  return lhs *= rhs;
+}
+
+// ==========================================================================
+// OPERATOR/(fixed16_16,fixed16_16)
+// ==========================================================================
+constexpr fixed16_16 operator/(fixed16_16 lhs, fixed16_16 const &rhs)
+{
+  return lhs /= rhs;
+}
+
+// ==========================================================================
+// ABS(fixed16_16)
+// ==========================================================================
+constexpr fixed16_16 abs(fixed16_16 const &value)
+{
+  return value < fixed16_16{} ? -value : value;
+}
+
+// ==========================================================================
+// SQRT(fixed16_16)
+// ==========================================================================
+inline fixed16_16 sqrt(fixed16_16 const &value)
+{
+  return fixed16_16{std::sqrt(static_cast<double>(value))};
+}
+
+}  // namespace textray
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace textray {
+
+//* =========================================================================
+/// \brief A frame to be rendered by a frame scheduler.
+//* =========================================================================
+struct frame_job
+{
+  /// The time by which the frame ought to be rendered.  Of the frames
+  /// that are waiting, those with the earliest deadlines are rendered
+  /// first.
+  std::chrono::steady_clock::time_point deadline;
+
+  /// A number, such as the id of the client whose frame this is, that
+  /// chooses the worker that the frame is first given to.  The frames of
+  /// a client are then usually rendered by the same worker, whose cache
+  /// is likely to still hold the client's panorama and textures.
+  std::uint64_t home{0};
+
+  /// Renders the frame and hands it on.  This is called on one of the
+  /// scheduler's workers.
+  std::function<void()> render;
+
+  /// Called instead of render if the scheduler is destroyed before the
+  /// frame is rendered, on the thread that destroys it, so that whoever
+  /// waits for the frame can stop waiting.  This may be empty.
+  std::function<void()> cancel;
+};
+
+//* =========================================================================
+/// \brief Renders the frames of every client of the server on a fixed set
+/// of worker threads, apart from those that handle the network.
+/// \par
+/// Each worker has a mailbox, into which the frames whose home it is are
+/// submitted, and a work-stealing deque.  Before it takes each frame, a
+/// worker empties its mailbox into its deque, which it keeps in order of
+/// deadline, with the most urgent frame at the end from which it pops.  A
+/// frame with an early deadline therefore waits only for the frames in its
+/// deque that are more urgent.  A worker whose deque is empty steals from
+/// the other end of another's, and so takes the frames that can best
+/// afford to move; failing that, it takes in the mailbox of a worker that
+/// is busy.  A client whose frames are slow to render therefore holds up
+/// only the worker rendering it: the frames queued behind it are taken by
+/// others.
+//* =========================================================================
+class frame_scheduler  // NOLINT
+{
+ public:
+  //* =====================================================================
+  /// \brief Constructor.  Starts the given number of workers, of which
+  /// there must be at least one.
+  //* =====================================================================
+  explicit frame_scheduler(unsigned int workers);
+
+  //* =====================================================================
+  /// \brief Destructor.  Stops the workers once they have finished the
+  /// frames that they are rendering.  Frames that are still waiting are
+  /// cancelled rather than rendered.
+  //* =====================================================================
+  ~frame_scheduler();
+
+  //* =====================================================================
+  /// \brief Submits a frame to be rendered.  This may be called from any
+  /// thread.
+  //* =====================================================================
+  void submit(frame_job job);
+
+ private:
+  struct impl;
+  std::unique_ptr<impl> pimpl_;
+};
+
+}  // namespace textray
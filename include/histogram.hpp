@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace textray {
+
+//* =========================================================================
+/// \brief A histogram of non-negative integer samples with a bounded
+/// relative error, suitable for recording latencies.
+/// \par
+/// Samples are counted in buckets that are linear within each power of
+/// two (16 sub-buckets per power), so that the value of any quantile is
+/// reported to within about 6% of the true value, regardless of its
+/// magnitude.  Samples of 2^40 or more are counted in the highest bucket.
+/// Recording is lock-free and may happen concurrently with reading.
+//* =========================================================================
+class histogram
+{
+ public:
+  //* =====================================================================
+  /// \brief Records a sample.
+  //* =====================================================================
+  void record(std::uint64_t value);
+
+  //* =====================================================================
+  /// \brief Adds all the samples of another histogram to this one.
+  //* =====================================================================
+  void merge(histogram const &other);
+
+  //* =====================================================================
+  /// \brief Returns the number of samples recorded.
+  //* =====================================================================
+  [[nodiscard]] std::uint64_t count() const;
+
+  //* =====================================================================
+  /// \brief Returns the sum of all samples recorded.
+  //* =====================================================================
+  [[nodiscard]] std::uint64_t sum() const;
+
+  //* =====================================================================
+  /// \brief Returns an estimate of the value at the given quantile, which
+  /// must be between 0 and 1, or 0 if no samples have been recorded.
+  //* =====================================================================
+  [[nodiscard]] std::uint64_t quantile(double q) const;
+
+ private:
+  static constexpr std::size_t sub_bucket_bits = 4;
+  static constexpr std::size_t sub_buckets = std::size_t{1} << sub_bucket_bits;
+  static constexpr std::size_t value_bits = 40;
+  static constexpr std::size_t bucket_count =
+      (value_bits - sub_bucket_bits + 1) * sub_buckets;
+
+  static std::size_t bucket_of(std::uint64_t value);
+  static std::uint64_t value_of(std::size_t bucket);
+
+  std::array<std::atomic<std::uint64_t>, bucket_count> buckets_{};
+  std::atomic<std::uint64_t> count_{0};
+  std::atomic<std::uint64_t> sum_{0};
+};
+
+}  // namespace textray
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "floorplan.hpp"
+#include "vector2d.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace textray {
+
+//* =========================================================================
+/// \brief The faces of a tile of a floorplan, named for the direction from
+/// the tile in which each faces: west and east towards lower and higher x,
+/// north and south towards lower and higher y.
+//* =========================================================================
+enum class wall_face : std::uint8_t
+{
+  west,
+  east,
+  north,
+  south
+};
+
+//* =========================================================================
+/// \brief A static source of light on a floorplan.
+//* =========================================================================
+struct light
+{
+  vector2d position;
+
+  /// The percentage of darkness that the light removes from a face that
+  /// it shines directly onto at no distance.
+  double brightness{0};
+
+  /// The distance at which the light no longer reaches.
+  double reach{0};
+};
+
+constexpr bool operator==(light const &lhs, light const &rhs)
+{
+  return lhs.position == rhs.position && lhs.brightness == rhs.brightness
+         && lhs.reach == rhs.reach;
+}
+
+constexpr bool operator!=(light const &lhs, light const &rhs)
+{
+  return !(lhs == rhs);
+}
+
+//* =========================================================================
+/// \brief The light that a floorplan's static lights cast onto each face of
+/// its walls, baked into a lightmap that parallels the floorplan's grid of
+/// tiles.
+/// \par
+/// Each face is divided into a row of luxels across its width, and each
+/// luxel holds the percentage of darkness that the lights remove from that
+/// part of the face, taking into account the distance and angle of each
+/// light and whether any opaque wall stands between them.  Rendering then
+/// only looks up a single luxel for each ray.
+/// \par
+/// The lightmap does not keep its floorplan, and so must be told when the
+/// floorplan changes, so that it can rebake only the faces affected.
+//* =========================================================================
+class lightmap
+{
+ public:
+  //* =====================================================================
+  /// \brief The number of luxels across each face of a tile.
+  //* =====================================================================
+  static constexpr std::size_t luxels_per_face = 8;
+
+  //* =====================================================================
+  /// \brief Constructor.  Bakes the light that the given lights cast onto
+  /// every face of the floorplan's walls.
+  //* =====================================================================
+  lightmap(floorplan const &plan, std::vector<light> lights);
+
+  //* =====================================================================
+  /// \brief Returns the lights of the lightmap.
+  //* =====================================================================
+  [[nodiscard]] std::vector<light> const &lights() const;
+
+  //* =====================================================================
+  /// \brief Replaces the lights of the lightmap, rebaking only the faces
+  /// within reach of a light that was added, removed or changed.
+  //* =====================================================================
+  void set_lights(floorplan const &plan, std::vector<light> lights);
+
+  //* =====================================================================
+  /// \brief Rebakes the faces that may be affected by a change to the tile
+  /// at the given position of the floorplan: its own faces and those of
+  /// its neighbours, and those within reach of any light that reaches the
+  /// tile, and so on which it may now cast or lift a shadow.
+  //* =====================================================================
+  void tile_changed(floorplan const &plan, std::size_t x, std::size_t y);
+
+  //* =====================================================================
+  /// \brief Returns the percentage of darkness removed from the given face
+  /// of the tile at the given position, at the given position across the
+  /// face from 0 (its left edge, as seen from in front of it) to 1 (its
+  /// right).  Nothing is removed from a tile outside the floorplan.
+  //* =====================================================================
+  [[nodiscard]] std::uint8_t luxel(
+      std::size_t x, std::size_t y, wall_face face, double u) const;
+
+ private:
+  void bake_faces_within(
+      floorplan const &plan, vector2d const &centre, double reach);
+  void bake_tile(floorplan const &plan, std::size_t x, std::size_t y);
+
+  std::size_t width_;
+  std::size_t height_;
+  std::vector<light> lights_;
+  std::vector<std::uint8_t> luxels_;
+};
+
+}  // namespace textray
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "settings.hpp"
+#include <terminalpp/extent.hpp>
+#include <cstddef>
+
+namespace textray {
+
+//* =========================================================================
+/// \brief Returns an estimate of the memory used by a client with the
+/// given window size, in bytes.  This accounts for each copy of the frame
+/// that is held for the client (its canvas, the camera's image, the frame
+/// being rendered, the rendered frame waiting to be drawn and the
+/// terminal's record of the screen), the most that the camera's panorama
+/// may hold across the window's width, its input buffer and its Telnet
+/// and MCCP state.
+//* =========================================================================
+std::size_t estimated_client_memory(
+    terminalpp::extent window_size, settings const &config);
+
+//* =========================================================================
+/// \brief Returns the largest window size, no larger than the requested
+/// size, that is within the limits on window dimensions and per-client
+/// memory in the settings.  A window that exceeds the memory budget is
+/// shrunk in proportion, so that its aspect ratio is roughly preserved.
+//* =========================================================================
+terminalpp::extent clamp_window_size(
+    terminalpp::extent requested_size, settings const &config);
+
+}  // namespace textray
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "histogram.hpp"
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+
+namespace textray {
+
+//* =========================================================================
+/// \brief Counters and histograms that describe the work done on behalf
+/// of a single client.  All members may be updated from any thread.
+//* =========================================================================
+struct client_metrics
+{
+  //* =====================================================================
+  /// \brief A number that identifies the client in reports.
+  //* =====================================================================
+  std::uint64_t id{0};
+
+  std::atomic<std::uint64_t> input_tokens{0};
+  std::atomic<std::uint64_t> ticks{0};
+  std::atomic<std::uint64_t> repaint_requests{0};
+  std::atomic<std::uint64_t> repaints_coalesced{0};
+  std::atomic<std::uint64_t> frames{0};
+  std::atomic<std::uint64_t> frames_dropped{0};
+  std::atomic<std::uint64_t> bytes_written{0};  // before compression
+  std::atomic<std::uint64_t> bytes_sent{0};     // after compression
+  std::atomic<std::uint64_t> window_clamps{0};
+  std::atomic<std::uint64_t> input_bytes_discarded{0};
+
+  //* =====================================================================
+  /// \brief An estimate of the memory currently used by the client, in
+  /// bytes.
+  //* =====================================================================
+  std::atomic<std::uint64_t> memory_bytes{0};
+
+  //* =====================================================================
+  /// \brief The time taken to render each frame of the camera, in
+  /// microseconds.
+  //* =====================================================================
+  histogram render_time_us;
+
+  //* =====================================================================
+  /// \brief The time from a frame being submitted to the frame scheduler
+  /// to its rendering beginning, in microseconds.
+  //* =====================================================================
+  histogram frame_wait_us;
+
+  //* =====================================================================
+  /// \brief The time from a keypress arriving from the client to the last
+  /// byte of the frame that it caused being handed to the socket, in
+  /// microseconds.
+  //* =====================================================================
+  histogram input_latency_us;
+};
+
+//* =========================================================================
+/// \brief Aggregates the metrics of every client of the server, including
+/// those that have since disconnected.
+//* =========================================================================
+class server_metrics  // NOLINT
+{
+ public:
+  //* =====================================================================
+  /// \brief Constructor
+  //* =====================================================================
+  server_metrics();
+
+  //* =====================================================================
+  /// \brief Destructor
+  //* =====================================================================
+  ~server_metrics();
+
+  //* =====================================================================
+  /// \brief Creates the metrics for a new client.  When the last
+  /// reference to them is released, their totals are retained in the
+  /// server-wide totals.
+  //* =====================================================================
+  std::shared_ptr<client_metrics> make_client_metrics();
+
+  //* =====================================================================
+  /// \brief Writes the metrics in the Prometheus text exposition format.
+  /// \param per_client if true, then the metrics of each connected client
+  /// are written in addition to the server-wide totals.
+  //* =====================================================================
+  void write_prometheus(std::ostream &out, bool per_client) const;
+
+ private:
+  struct impl;
+  std::shared_ptr<impl> pimpl_;
+};
+
+}  // namespace textray
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "settings.hpp"
+#include <boost/asio/io_context.hpp>
+#include <memory>
+
+namespace textray {
+
+class server_metrics;
+
+//* =========================================================================
+/// \brief Publishes the server's metrics, as configured by the settings,
+/// to an admin port on the loopback interface and/or to a file that is
+/// rewritten periodically.
+//* =========================================================================
+class metrics_reporter  // NOLINT
+{
+ public:
+  //* =====================================================================
+  /// \brief Constructor
+  //* =====================================================================
+  metrics_reporter(
+      boost::asio::io_context &io_context,
+      server_metrics const &metrics,
+      settings const &config);
+
+  //* =====================================================================
+  /// \brief Destructor
+  //* =====================================================================
+  ~metrics_reporter();
+
+  //* =====================================================================
+  /// \brief Stops publishing metrics.
+  //* =====================================================================
+  void shutdown();
+
+ private:
+  struct impl;
+  std::unique_ptr<impl> pimpl_;
+};
+
+}  // namespace textray
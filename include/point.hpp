@@ -7,26 +7,27 @@ namespace textray {
 /// \par
 /// A class that represents a point in space, where x is the co-ordinate
 /// along the horizontal axis and y being the co-ordinate along the vertical
-/// axis.
+/// axis.  The co-ordinates are of type T.
 //* =========================================================================
-struct point
+template <class T>
+struct basic_point
 {
   //* =====================================================================
   /// \brief Default Constructor
   /// \par
-  /// Constructs a point, leaving the values uninitialized.
+  /// Constructs a basic_point with each co-ordinate value-initialized.
   //* =====================================================================
-  constexpr point() : x{}, y{}
+  constexpr basic_point() : x{}, y{}
   {
   }
 
   //* =====================================================================
   /// \brief Constructor
   /// \par
-  /// Constructs a point from a passed in x co-ordinate and a passed in
-  /// y co-ordinate.
+  /// Constructs a basic_point from a passed in x co-ordinate and a passed
+  /// in y co-ordinate.
   //* =====================================================================
-  constexpr point(double x_coordinate, double y_coordinate)
+  constexpr basic_point(T x_coordinate, T y_coordinate)
     : x(x_coordinate), y(y_coordinate)
   {
   }
@@ -34,7 +35,7 @@ struct point
   //* =====================================================================
   /// \brief Addition
   //* =====================================================================
-  constexpr point &operator+=(point const &rhs)
+  constexpr basic_point &operator+=(basic_point const &rhs)
   {
     x += rhs.x;
     y += rhs.y;
@@ -44,45 +45,56 @@ struct point
   //* =====================================================================
   /// \brief Subtraction
   //* =====================================================================
-  constexpr point &operator-=(point const &rhs)
+  constexpr basic_point &operator-=(basic_point const &rhs)
   {
     x -= rhs.x;
     y -= rhs.y;
     return *this;
   }
 
-  double x;
-  double y;
+  T x;
+  T y;
 };
 
+//* =========================================================================
+/// \brief A point in space with double-precision co-ordinates.
+//* =========================================================================
+using point = basic_point<double>;
+
 // ==========================================================================
-// OPERATOR==(point,point)
+// OPERATOR==(basic_point,basic_point)
 // ==========================================================================
-constexpr bool operator==(point const &lhs, point const &rhs)
+template <class T>
+constexpr bool operator==(basic_point<T> const &lhs, basic_point<T> const &rhs)
 {
   return lhs.x == rhs.x && lhs.y == rhs.y;
 }
 
 // ==========================================================================
-// OPERATOR!=(point,point)
+// OPERATOR!=(basic_point,basic_point)
 // ==========================================================================
-constexpr bool operator!=(point const &lhs, point const &rhs)
+template <class T>
+constexpr bool operator!=(basic_point<T> const &lhs, basic_point<T> const &rhs)
 {
   return !(lhs == rhs);
 }
 
 // ==========================================================================
-// OPERATOR+(point,point)
+// OPERATOR+(basic_point,basic_point)
 // ==========================================================================
-constexpr point operator+(point lhs, point const &rhs)
+template <class T>
+constexpr basic_point<T> operator+(
+    basic_point<T> lhs, basic_point<T> const &rhs)
 {
   return lhs += rhs;
 }
 
 // ==========================================================================
-// OPERATOR-(point,point)
+// OPERATOR-(basic_point,basic_point)
 // ==========================================================================
-constexpr point operator-(point lhs, point const &rhs)
+template <class T>
+constexpr basic_point<T> operator-(
+    basic_point<T> lhs, basic_point<T> const &rhs)
 {
   return lhs -= rhs;
 }
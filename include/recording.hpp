@@ -0,0 +1,71 @@
+#pragma once
+
+#include "connection.hpp"
+#include <boost/asio/io_context.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace textray {
+
+//* =========================================================================
+/// \brief An event that was received from a client's connection.
+//* =========================================================================
+struct recorded_event
+{
+  enum class kind : char
+  {
+    data = 'd',
+    window_size = 'w',
+    terminal_type = 't',
+  };
+
+  kind type{kind::data};
+
+  //* =====================================================================
+  /// \brief The time of the event, relative to the start of the
+  /// recording.
+  //* =====================================================================
+  std::chrono::microseconds time{0};
+
+  //* =====================================================================
+  /// \brief The data received (after Telnet processing), or the terminal
+  /// type.
+  //* =====================================================================
+  std::string text;
+
+  std::uint16_t width{0};
+  std::uint16_t height{0};
+};
+
+//* =========================================================================
+/// \brief Creates an endpoint that forwards to the passed endpoint, but
+/// also records each piece of data, window size and terminal type that it
+/// receives, with timestamps, in the named file.  If the file cannot be
+/// written, then a warning is issued and nothing is recorded.
+//* =========================================================================
+std::unique_ptr<connection_endpoint> make_recording_endpoint(
+    std::unique_ptr<connection_endpoint> endpoint,
+    std::string const &filename);
+
+//* =========================================================================
+/// \brief Loads the events of a recording made by a recording endpoint.
+/// \throws std::runtime_error if the file cannot be read or is not a
+/// valid recording.
+//* =========================================================================
+std::vector<recorded_event> load_recording(std::string const &filename);
+
+//* =========================================================================
+/// \brief Creates an endpoint that replays the passed events as fast as
+/// they are read, regardless of their timestamps.  Each read yields the
+/// next data event, preceded by any window size and terminal type events
+/// that were recorded before it.  Once all events have been replayed, the
+/// endpoint is no longer alive.  Anything written to it is discarded,
+/// but counted in its metrics.
+//* =========================================================================
+std::unique_ptr<connection_endpoint> make_replay_endpoint(
+    boost::asio::io_context &io_context, std::vector<recorded_event> events);
+
+}  // namespace textray
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "colour_depth.hpp"
+#include "floorplan.hpp"
+#include "lightmap.hpp"
+#include "render_mode.hpp"
+#include "render_precision.hpp"
+#include "shade_table.hpp"
+#include "vector2d.hpp"
+#include <terminalpp/string.hpp>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace textray {
+
+//* =========================================================================
+/// \brief What rendering needs to know of a floorplan as a whole, which is
+/// found once for the floorplan rather than on every frame.
+//* =========================================================================
+struct floorplan_summary
+{
+  /// The height of the tallest wall.  A ray need be cast no further once
+  /// nothing beyond could rise above the walls that it has hit.
+  double tallest_wall{0};
+
+  /// Whether any tile has a texture on its floor or ceiling.  Otherwise,
+  /// the floor and ceiling are drawn without being cast.
+  bool surfaces_textured{false};
+};
+
+//* =========================================================================
+/// \brief Options that govern how a frame is rendered.
+//* =========================================================================
+struct render_options
+{
+  render_mode mode{render_mode::cells};
+  render_precision precision{render_precision::double_precision};
+
+  //* =====================================================================
+  /// \brief The interval at which columns of rays are cast before those
+  /// between them are refined.  Columns between two that hit the same
+  /// face of a wall are found without being cast; 1 casts every column.
+  /// Views that are resampled from a panorama ignore this.
+  //* =====================================================================
+  int column_stride{1};
+
+  //* =====================================================================
+  /// \brief The static lighting of the floorplan's walls, which must have
+  /// been baked for the floorplan that is rendered, or null for walls that
+  /// are shaded by their distance alone.
+  //* =====================================================================
+  lightmap const *lighting{nullptr};
+
+  //* =====================================================================
+  /// \brief The summary of the floorplan that is rendered, which must have
+  /// been made for that floorplan, or null for one to be made afresh for
+  /// each frame.
+  //* =====================================================================
+  floorplan_summary const *summary{nullptr};
+};
+
+//* =========================================================================
+/// \brief A cache of the walls seen in every direction from a single
+/// position on a floorplan, so that views that differ only in heading can
+/// be rendered without casting their rays again.
+/// \par
+/// The directions are sampled at a resolution matched to the view, and
+/// each is cast only when a view first needs it.  The panorama is
+/// invalidated automatically when a view is rendered from a different
+/// position or floorplan, or at a different resolution; it must be
+/// invalidated explicitly if its floorplan is modified in place.
+//* =========================================================================
+class panorama
+{
+ public:
+  panorama();
+  panorama(panorama &&other) noexcept;
+  ~panorama();
+  panorama &operator=(panorama &&other) noexcept;
+
+  //* =====================================================================
+  /// \brief Discards every direction that has been cast.
+  //* =====================================================================
+  void invalidate();
+
+  //* =====================================================================
+  /// \brief Returns the most memory, in bytes, that a panorama holds for
+  /// each cell across the width of the views that it serves, in any
+  /// render mode.
+  //* =====================================================================
+  [[nodiscard]] static std::size_t max_bytes_per_cell_column();
+
+ private:
+  friend std::vector<terminalpp::string> render_frame(
+      terminalpp::extent size,
+      floorplan const &plan,
+      shade_table const &shades,
+      vector2d const &position,
+      double heading,
+      double fov,
+      render_options const &options,
+      panorama &cache);
+
+  struct impl;
+  std::unique_ptr<impl> pimpl_;
+};
+
+//* =========================================================================
+/// \brief Summarises a floorplan.  The summary must be made again if the
+/// floorplan is modified.
+//* =========================================================================
+floorplan_summary summarise_floorplan(floorplan const &plan);
+
+//* =========================================================================
+/// \brief Creates a shade table that contains every colour that rendering
+/// the floorplan requires: its ceiling, its floor and each of its tiles.
+//* =========================================================================
+shade_table make_shade_table(
+    floorplan const &plan, colour_depth depth, int bands);
+
+//* =========================================================================
+/// \brief Renders the view of the floorplan from a camera.
+/// \param size the size of the view, in cells.
+/// \param shades a shade table created for the floorplan.
+/// \param position position of the camera on the floorplan.
+/// \param heading view direction of the camera, in radians.
+/// \param fov horizontal field of view of the camera, in radians.
+/// \param options the way in which the view is mapped onto cells, and the
+/// precision with which it is cast.
+/// \return the rows of the view, from top to bottom.
+//* =========================================================================
+std::vector<terminalpp::string> render_frame(
+    terminalpp::extent size,
+    floorplan const &plan,
+    shade_table const &shades,
+    vector2d const &position,
+    double heading,
+    double fov,
+    render_options const &options);
+
+//* =========================================================================
+/// \brief Renders the view of the floorplan from a camera, taking the
+/// walls from a panorama.  Views that are resampled from a panorama may
+/// differ very slightly from those that are cast directly.
+//* =========================================================================
+std::vector<terminalpp::string> render_frame(
+    terminalpp::extent size,
+    floorplan const &plan,
+    shade_table const &shades,
+    vector2d const &position,
+    double heading,
+    double fov,
+    render_options const &options,
+    panorama &cache);
+
+}  // namespace textray
@@ -0,0 +1,22 @@
+#pragma once
+
+namespace textray {
+
+//* =========================================================================
+/// \brief The way in which the view is mapped onto the cells of a
+/// client's terminal.
+//* =========================================================================
+enum class render_mode
+{
+  cells,        // one ray per cell, with partially-filled cells at edges
+  half_blocks,  // one ray per cell, with upper and lower halves coloured
+  braille,      // one ray per column of braille dots, 2x4 dots per cell
+};
+
+//* =========================================================================
+/// \brief Returns the next render mode in sequence, wrapping around.  This
+/// is useful to allow users to cycle through the available modes.
+//* =========================================================================
+render_mode next_render_mode(render_mode mode);
+
+}  // namespace textray
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+namespace textray {
+
+//* =========================================================================
+/// \brief The scalar type with which rays are cast and walls projected.
+/// At terminal resolution, the narrower types give results that differ
+/// from double precision in only a handful of cells.
+//* =========================================================================
+enum class render_precision
+{
+  double_precision,  // double
+  single_precision,  // float
+  fixed_point,       // fixed16_16
+};
+
+//* =========================================================================
+/// \brief Returns the render precision with the given name ("double",
+/// "float" or "fixed"), if there is one.
+//* =========================================================================
+std::optional<render_precision> render_precision_from_name(
+    std::string_view name);
+
+//* =========================================================================
+/// \brief Returns the name of the given render precision.
+//* =========================================================================
+std::string_view render_precision_name(render_precision precision);
+
+}  // namespace textray
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "render_precision.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace textray {
+
+//* =========================================================================
+/// \brief Server-wide settings that govern the behaviour of each client.
+//* =========================================================================
+struct settings
+{
+  //* =====================================================================
+  /// \brief The interval of the fixed simulation tick.  Input that
+  /// arrives between ticks is accumulated and applied at the next tick,
+  /// and at most one frame is rendered per tick.  A zero interval
+  /// processes input and renders as soon as possible.
+  //* =====================================================================
+  std::chrono::milliseconds tick_interval{50};
+
+  //* =====================================================================
+  /// \brief The number of threads, apart from those that handle the
+  /// network, on which the frame scheduler renders every client's frames.
+  /// Each frame is then handed back to its client's strand to be sent, so
+  /// that rendering never holds up the input of any client.  Zero renders
+  /// each frame on its client's strand.
+  //* =====================================================================
+  unsigned int render_threads{0};
+
+  //* =====================================================================
+  /// \brief Whether each client's camera renders its walls from a
+  /// panorama cast at its position, so that turning on the spot casts no
+  /// rays.
+  //* =====================================================================
+  bool panorama{true};
+
+  //* =====================================================================
+  /// \brief The precision in which each client's camera casts its rays.
+  //* =====================================================================
+  render_precision precision{render_precision::double_precision};
+
+  //* =====================================================================
+  /// \brief The interval at which each client's camera casts columns of
+  /// rays before refining those between them.  Refined views are
+  /// identical to those in which every column is cast; 1 casts every
+  /// column.
+  //* =====================================================================
+  int column_stride{8};
+
+  //* =====================================================================
+  /// \brief The largest window that is rendered for a client.  A client
+  /// that reports a larger window has only this much of it drawn.
+  //* =====================================================================
+  std::uint16_t max_window_width{512};
+  std::uint16_t max_window_height{256};
+
+  //* =====================================================================
+  /// \brief The memory that each client may use, in bytes.  A client
+  /// whose window would take it over budget has its window shrunk.
+  //* =====================================================================
+  std::size_t client_memory_budget{32 * 1024 * 1024};
+
+  //* =====================================================================
+  /// \brief The most input that is buffered for a client between reads,
+  /// in bytes.  Any more is discarded.
+  //* =====================================================================
+  std::size_t max_input_buffer{64 * 1024};
+
+  //* =====================================================================
+  /// \brief The port on the loopback interface on which a report of the
+  /// server's metrics is served to anyone who connects.  Zero disables
+  /// the admin port.
+  //* =====================================================================
+  std::uint16_t admin_port{0};
+
+  //* =====================================================================
+  /// \brief A file to which a report of the server's metrics is written
+  /// every metrics_interval.  Empty disables the file.
+  //* =====================================================================
+  std::string metrics_file;
+
+  //* =====================================================================
+  /// \brief The interval between writes of the metrics file.  Zero
+  /// disables the file.
+  //* =====================================================================
+  std::chrono::seconds metrics_interval{15};
+
+  //* =====================================================================
+  /// \brief A directory in which the input of each client is recorded,
+  /// so that it can later be replayed with textray_replay.  Empty
+  /// disables recording.
+  //* =====================================================================
+  std::string recording_directory;
+};
+
+}  // namespace textray
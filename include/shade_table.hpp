@@ -0,0 +1,79 @@
+#pragma once
+
+#include "colour_depth.hpp"
+#include <terminalpp/attribute.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace textray {
+
+//* =========================================================================
+/// \brief A table of precomputed, progressively darker shades of a set of
+/// base colours.
+/// \par
+/// Each base colour added to the table is darkened once for every
+/// percentage of darkness and quantised to the table's colour depth when
+/// the row is built, so that the renderer only needs to perform a lookup
+/// for each cell it draws.
+/// \par
+/// The table may also be divided into a number of bands, each of which
+/// maps a range of darkness onto a single shade.  Neighbouring cells at
+/// similar distances then share an attribute, which reduces the number of
+/// attribute changes that must be sent to the terminal.
+//* =========================================================================
+class shade_table
+{
+ public:
+  //* =====================================================================
+  /// \brief The number of shades stored for each base colour, one for
+  /// each percentage of darkness from 0% to 100% inclusive.
+  //* =====================================================================
+  static constexpr std::size_t shades_per_row = 101;
+
+  //* =====================================================================
+  /// \brief Constructor
+  /// \param depth the colour depth to which the shades are quantised.
+  /// \param bands the number of distinct shades of each colour, or 0 for
+  /// one shade per percentage of darkness.
+  //* =====================================================================
+  explicit shade_table(
+      colour_depth depth = colour_depth::true_colour, int bands = 0);
+
+  //* =====================================================================
+  /// \brief Returns the colour depth to which the shades are quantised.
+  //* =====================================================================
+  [[nodiscard]] colour_depth depth() const;
+
+  //* =====================================================================
+  /// \brief Returns the number of bands into which the shades are
+  /// divided, or 0 if they are not banded.
+  //* =====================================================================
+  [[nodiscard]] int bands() const;
+
+  //* =====================================================================
+  /// \brief Adds a row of shades for the given base colour, if one does
+  /// not already exist, and returns the index of that row.
+  //* =====================================================================
+  std::size_t add(terminalpp::colour const &base);
+
+  //* =====================================================================
+  /// \brief Returns the index of the row of shades for the given base
+  /// colour, which must already have been added.
+  //* =====================================================================
+  [[nodiscard]] std::size_t row_of(terminalpp::colour const &base) const;
+
+  //* =====================================================================
+  /// \brief Returns the given row's shade for the given darkness, as a
+  /// percentage between 0 (the base colour) and 100 (black).
+  //* =====================================================================
+  [[nodiscard]] terminalpp::attribute const &shade(
+      std::size_t row, double darkness_percentage) const;
+
+ private:
+  colour_depth depth_;
+  int bands_;
+  std::vector<terminalpp::colour> bases_;
+  std::vector<terminalpp::attribute> shades_;
+};
+
+}  // namespace textray
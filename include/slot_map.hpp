@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace textray {
+
+//* =========================================================================
+/// \brief A container that provides constant-time insertion and removal,
+/// addressed by keys that remain stable across other insertions and
+/// removals.
+/// \par
+/// Each key contains a generation that is incremented whenever its slot is
+/// vacated, so that a stale key to a slot that has since been reused is
+/// detected rather than referring to the wrong element.
+/// \par
+/// slot_map provides no synchronisation of its own.
+//* =========================================================================
+template <class T>
+class slot_map
+{
+ public:
+  //* =====================================================================
+  /// \brief A key that addresses an element of the slot_map.
+  //* =====================================================================
+  struct key
+  {
+    std::uint32_t index;
+    std::uint32_t generation;
+  };
+
+  //* =====================================================================
+  /// \brief Inserts a value, returning the key by which it can be found.
+  //* =====================================================================
+  key insert(T value)
+  {
+    std::uint32_t index;
+
+    if (free_slots_.empty())
+    {
+      index = static_cast<std::uint32_t>(slots_.size());
+      slots_.emplace_back();
+    }
+    else
+    {
+      index = free_slots_.back();
+      free_slots_.pop_back();
+    }
+
+    auto &new_slot = slots_[index];
+    new_slot.value = std::move(value);
+    new_slot.occupied = true;
+    ++size_;
+
+    return {index, new_slot.generation};
+  }
+
+  //* =====================================================================
+  /// \brief Returns a pointer to the value addressed by the key, or
+  /// nullptr if the key is stale.
+  //* =====================================================================
+  T *find(key k)
+  {
+    if (k.index >= slots_.size())
+    {
+      return nullptr;
+    }
+
+    auto &found_slot = slots_[k.index];
+    return found_slot.occupied && found_slot.generation == k.generation
+               ? &found_slot.value
+               : nullptr;
+  }
+
+  //* =====================================================================
+  /// \brief Removes the value addressed by the key, if the key is not
+  /// stale.  Returns whether a value was removed.
+  //* =====================================================================
+  bool erase(key k)
+  {
+    if (find(k) == nullptr)
+    {
+      return false;
+    }
+
+    // The value is moved out so that it is destroyed only after the slot
+    // map is once again consistent.
+    auto &erased_slot = slots_[k.index];
+    [[maybe_unused]] auto const erased_value = std::move(erased_slot.value);
+    erased_slot.value = T{};
+    erased_slot.occupied = false;
+    ++erased_slot.generation;
+    free_slots_.push_back(k.index);
+    --size_;
+
+    return true;
+  }
+
+  //* =====================================================================
+  /// \brief Calls the passed function for each value in the slot_map.
+  //* =====================================================================
+  template <class Function>
+  void for_each(Function &&fn)
+  {
+    for (auto &each_slot : slots_)
+    {
+      if (each_slot.occupied)
+      {
+        fn(each_slot.value);
+      }
+    }
+  }
+
+  //* =====================================================================
+  /// \brief Returns the number of values in the slot_map.
+  //* =====================================================================
+  [[nodiscard]] std::size_t size() const
+  {
+    return size_;
+  }
+
+ private:
+  struct slot
+  {
+    T value{};
+    std::uint32_t generation{0};
+    bool occupied{false};
+  };
+
+  std::vector<slot> slots_;
+  std::vector<std::uint32_t> free_slots_;
+  std::size_t size_{0};
+};
+
+}  // namespace textray
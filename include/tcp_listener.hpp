@@ -0,0 +1,55 @@
+#pragma once
+
+#include <serverpp/core.hpp>
+#include <boost/asio/io_context.hpp>
+#include <functional>
+#include <memory>
+
+namespace serverpp {
+class tcp_socket;
+}
+
+namespace textray {
+
+//* =========================================================================
+/// \brief A listening socket that may share its port with other listeners
+/// by means of SO_REUSEPORT.
+/// \par
+/// This allows several io_contexts to each accept connections on the same
+/// port, with the operating system distributing new connections among
+/// them, so that each connection is handled entirely by the io_context
+/// that accepted it.
+//* =========================================================================
+class tcp_listener  // NOLINT
+{
+ public:
+  using connection_handler = std::function<void(serverpp::tcp_socket &&)>;
+
+  //* =====================================================================
+  /// \brief Constructor.  Begins listening on the given port, calling
+  /// the passed handler on the io_context's thread whenever a new
+  /// connection is accepted.
+  /// \throws boost::system::system_error if the port cannot be shared on
+  /// this platform or cannot be bound.
+  //* =====================================================================
+  tcp_listener(
+      boost::asio::io_context &io_context,
+      serverpp::port_identifier port,
+      connection_handler handler);
+
+  //* =====================================================================
+  /// \brief Destructor
+  //* =====================================================================
+  ~tcp_listener();
+
+  //* =====================================================================
+  /// \brief Stops accepting new connections.
+  //* =====================================================================
+  void shutdown();
+
+ private:
+  struct impl;
+  std::unique_ptr<impl> pimpl_;
+};
+
+}  // namespace textray
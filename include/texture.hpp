@@ -0,0 +1,107 @@
+#pragma once
+
+#include <terminalpp/colour.hpp>
+#include <terminalpp/glyph.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace textray {
+
+//* =========================================================================
+/// \brief A single texel of a texture: a glyph, drawn in one of the colours
+/// of the texture's palette.
+//* =========================================================================
+struct texel
+{
+  terminalpp::glyph glyph;
+  std::uint8_t colour{0};
+};
+
+//* =========================================================================
+/// \brief A grid of texels with which each face of a wall is drawn.
+/// \par
+/// The texels are stored column-major, since each column of a view draws
+/// a single column of a texture.  The texture is also stored at a number
+/// of successively coarser mip levels, each half the width and height of
+/// the last, so that a distant wall is drawn from a column of about as
+/// many texels as the rows that it covers.  Since texels cannot be
+/// blended, each texel of a coarser level takes the most common colour of
+/// the block of four from which it was reduced.
+//* =========================================================================
+class texture
+{
+ public:
+  //* =====================================================================
+  /// \brief Constructor
+  /// \param palette the colours of the texels, of which there may be at
+  /// most 256.
+  /// \param rows the rows of texels, from top to bottom, each of which
+  /// must be the same width.
+  /// \throws std::invalid_argument if the texture is empty or ragged, or
+  /// if a texel's colour is not in the palette.
+  //* =====================================================================
+  texture(
+      std::vector<terminalpp::colour> palette,
+      std::vector<std::vector<texel>> const &rows);
+
+  //* =====================================================================
+  /// \brief Returns the colours of the texels.
+  //* =====================================================================
+  [[nodiscard]] std::vector<terminalpp::colour> const &palette() const;
+
+  //* =====================================================================
+  /// \brief Returns the number of mip levels, the first of which is the
+  /// texture at its full size.
+  //* =====================================================================
+  [[nodiscard]] std::size_t levels() const;
+
+  //* =====================================================================
+  /// \brief Returns the width of the given mip level, in texels.
+  //* =====================================================================
+  [[nodiscard]] int width(std::size_t level = 0) const;
+
+  //* =====================================================================
+  /// \brief Returns the height of the given mip level, in texels.
+  //* =====================================================================
+  [[nodiscard]] int height(std::size_t level = 0) const;
+
+  //* =====================================================================
+  /// \brief Returns the coarsest mip level that is at least as high as a
+  /// wall that is projected onto the given number of rows.
+  //* =====================================================================
+  [[nodiscard]] std::size_t level_for(double projected_rows) const;
+
+  //* =====================================================================
+  /// \brief Returns the column of the given mip level at the given
+  /// position across the texture, from 0 (its left edge) to 1 (its
+  /// right).  The column's texels are contiguous, from top to bottom.
+  //* =====================================================================
+  [[nodiscard]] texel const *column(std::size_t level, double u) const;
+
+ private:
+  struct mip_level
+  {
+    int width;
+    int height;
+    std::size_t offset;
+  };
+
+  std::vector<terminalpp::colour> palette_;
+  std::vector<mip_level> levels_;
+  std::vector<texel> texels_;
+};
+
+//* =========================================================================
+/// \brief Creates a texture from rows of text: one row of glyphs for each
+/// row of colours, in which each character is the index of a colour in
+/// the palette, from '0'.
+/// \throws std::invalid_argument if the rows do not describe a texture.
+//* =========================================================================
+texture make_texture(
+    std::vector<terminalpp::colour> palette,
+    std::vector<std::string> const &glyph_rows,
+    std::vector<std::string> const &colour_rows);
+
+}  // namespace textray
@@ -1,12 +1,42 @@
 #pragma once
 
+#include "texture.hpp"
 #include <terminalpp/element.hpp>
+#include <memory>
 
 namespace textray {
 
 struct tile
 {
+  tile() = default;
+
+  // Floorplans are written as grids of the characters of their tiles'
+  // fills.
+  tile(terminalpp::byte character) : fill(terminalpp::glyph(character))
+  {
+  }
+
   terminalpp::element fill;
+
+  // The height of the wall, as a multiple of the standard height.  Walls
+  // may be seen over the tops of shorter walls in front of them.
+  double height{1.0};
+
+  // Rays pass through a see-through wall, such as a window or a grate,
+  // which is drawn over whatever is seen through it.  Those of its texels
+  // whose glyphs are spaces are clear, while the rest tint what lies
+  // behind them.  Without a texture, the whole wall is tinted glass.
+  bool see_through{false};
+
+  // The texture with which the faces of the wall are drawn.  Without one,
+  // they are drawn in the colour encoded in the fill.
+  std::shared_ptr<texture const> surface;
+
+  // The textures with which the floor and ceiling of the tile are drawn,
+  // across the tile from its lowest x and y.  Without them, the floor and
+  // ceiling are drawn in their plain colours.
+  std::shared_ptr<texture const> floor_surface;
+  std::shared_ptr<texture const> ceiling_surface;
 };
 
-}  // namespace textray
\ No newline at end of file
+}  // namespace textray
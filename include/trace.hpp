@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <iosfwd>
+
+//* =========================================================================
+/// \file
+/// \brief Lightweight tracing of the stages of the repaint pipeline.
+/// \par
+/// When built with TEXTRAY_WITH_TRACING, spans are recorded in a
+/// lock-free ring buffer belonging to the thread that recorded them, and
+/// may be written out at any time in the Chrome trace event format (for
+/// viewing in chrome://tracing or Perfetto).  Otherwise, every span and
+/// timestamp compiles away to nothing.
+//* =========================================================================
+
+#define TEXTRAY_TRACE_CONCAT_IMPL(lhs, rhs) lhs##rhs
+#define TEXTRAY_TRACE_CONCAT(lhs, rhs) TEXTRAY_TRACE_CONCAT_IMPL(lhs, rhs)
+
+namespace textray::trace {
+
+#ifdef TEXTRAY_WITH_TRACING
+
+using clock = std::chrono::steady_clock;
+
+//* =========================================================================
+/// \brief Records a span on the calling thread.  The name must be a
+/// string literal, or otherwise outlive every trace that is written.
+//* =========================================================================
+void record(char const *name, clock::time_point start, clock::time_point end);
+
+//* =========================================================================
+/// \brief Writes the spans currently held by every thread's ring buffer
+/// in the Chrome trace event format.
+//* =========================================================================
+void write_chrome_trace(std::ostream &out);
+
+//* =========================================================================
+/// \brief Records a span that lasts for the lifetime of this object.
+//* =========================================================================
+class span
+{
+ public:
+  explicit span(char const *name) : name_(name), start_(clock::now())
+  {
+  }
+
+  span(span const &) = delete;
+  span &operator=(span const &) = delete;
+
+  ~span()
+  {
+    record(name_, start_, clock::now());
+  }
+
+ private:
+  char const *name_;
+  clock::time_point start_;
+};
+
+//* =========================================================================
+/// \brief A point in time from which a span may later be recorded,
+/// possibly on another thread.
+//* =========================================================================
+class timestamp
+{
+ public:
+  void mark()
+  {
+    time_ = clock::now();
+  }
+
+  void record_since(char const *name) const
+  {
+    record(name, time_, clock::now());
+  }
+
+ private:
+  clock::time_point time_;
+};
+
+#define TEXTRAY_TRACE_SPAN(name)                     \
+  ::textray::trace::span const TEXTRAY_TRACE_CONCAT( \
+      textray_trace_span_, __LINE__)(name)
+
+#else
+
+class timestamp
+{
+ public:
+  void mark()
+  {
+  }
+
+  void record_since(char const * /*name*/) const
+  {
+  }
+};
+
+#define TEXTRAY_TRACE_SPAN(name) static_cast<void>(0)
+
+#endif
+
+}  // namespace textray::trace
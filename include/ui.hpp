@@ -1,12 +1,20 @@
 #pragma once
 
+#include "colour_depth.hpp"
 #include "floorplan.hpp"
+#include "render_mode.hpp"
+#include "render_precision.hpp"
 #include "vector2d.hpp"
 #include <munin/composite_component.hpp>
+#include <functional>
 #include <memory>
 
 namespace textray {
 
+struct camera_frame;
+struct client_metrics;
+class lightmap;
+
 class ui : public munin::composite_component  // NOLINT
 {
  public:
@@ -19,6 +27,26 @@ class ui : public munin::composite_component  // NOLINT
 
   void move_camera_to(vector2d const &position, double heading);
   void set_camera_fov(double fov);
+  void set_camera_colour_depth(colour_depth depth);
+  void set_camera_shade_bands(int bands);
+  void set_camera_render_mode(render_mode mode);
+  void set_camera_render_precision(render_precision precision);
+  void set_camera_column_stride(int stride);
+  void set_camera_lighting(std::shared_ptr<lightmap const> lighting);
+  void set_camera_panorama_enabled(bool enabled);
+  void set_camera_metrics(std::shared_ptr<client_metrics> metrics);
+
+  //* =====================================================================
+  /// \brief Returns a function that renders the camera's view on any
+  /// thread.  See camera::prepare_frame().
+  //* =====================================================================
+  [[nodiscard]] std::function<camera_frame()> prepare_camera_frame() const;
+
+  //* =====================================================================
+  /// \brief Sets a frame to be drawn by the camera the next time that it
+  /// is drawn.  See camera::set_frame().
+  //* =====================================================================
+  void set_camera_frame(camera_frame frame);
 
  private:
   struct impl;
@@ -9,26 +9,30 @@ namespace textray {
 /// \par
 /// A class that represents a vector in space, where x is the co-ordinate
 /// along the horizontal axis and y being the co-ordinate along the vertical
-/// axis.
+/// axis.  The co-ordinates are of type T, which may be any arithmetic type
+/// or a numeric type that behaves like one, such as fixed16_16.
 //* =========================================================================
-struct vector2d
+template <class T>
+struct basic_vector2d
 {
+  using value_type = T;
+
   //* =====================================================================
   /// \brief Default Constructor
   /// \par
-  /// Constructs a vector2d, leaving the values uninitialized.
+  /// Constructs a basic_vector2d with each co-ordinate value-initialized.
   //* =====================================================================
-  constexpr vector2d() : x{}, y{}
+  constexpr basic_vector2d() : x{}, y{}
   {
   }
 
   //* =====================================================================
   /// \brief Constructor
   /// \par
-  /// Constructs a vector2d from a passed in x co-ordinate and a passed in
-  /// y co-ordinate.
+  /// Constructs a basic_vector2d from a passed in x co-ordinate and a
+  /// passed in y co-ordinate.
   //* =====================================================================
-  constexpr vector2d(double x_coordinate, double y_coordinate)
+  constexpr basic_vector2d(T x_coordinate, T y_coordinate)
     : x(x_coordinate), y(y_coordinate)
   {
   }
@@ -36,7 +40,7 @@ struct vector2d
   //* =====================================================================
   /// \brief Addition
   //* =====================================================================
-  constexpr vector2d &operator+=(vector2d const &rhs)
+  constexpr basic_vector2d &operator+=(basic_vector2d const &rhs)
   {
     x += rhs.x;
     y += rhs.y;
@@ -46,7 +50,7 @@ struct vector2d
   //* =====================================================================
   /// \brief Subtraction
   //* =====================================================================
-  constexpr vector2d &operator-=(vector2d const &rhs)
+  constexpr basic_vector2d &operator-=(basic_vector2d const &rhs)
   {
     x -= rhs.x;
     y -= rhs.y;
@@ -56,93 +60,127 @@ struct vector2d
   //* ==========================================================================
   /// \brief Length
   //* ==========================================================================
-  [[nodiscard]] double length() const
+  [[nodiscard]] T length() const
   {
-    return std::sqrt(x * x + y * y);
+    using std::sqrt;
+    return sqrt(x * x + y * y);
   }
 
   //* ==========================================================================
   /// \brief Construct from angle, in radians
   //* ==========================================================================
-  static vector2d from_angle(double angle)
+  static basic_vector2d from_angle(double angle)
   {
-    return {std::cos(angle), std::sin(angle)};
+    return {static_cast<T>(std::cos(angle)), static_cast<T>(std::sin(angle))};
   }
 
-  double x;
-  double y;
+  T x;
+  T y;
 };
 
+//* =========================================================================
+/// \brief A vector in space with double-precision co-ordinates.
+//* =========================================================================
+using vector2d = basic_vector2d<double>;
+
 // ==========================================================================
-// OPERATOR==(vector2d,vector2d)
+// OPERATOR==(basic_vector2d,basic_vector2d)
 // ==========================================================================
-constexpr bool operator==(vector2d const &lhs, vector2d const &rhs)
+template <class T>
+constexpr bool operator==(
+    basic_vector2d<T> const &lhs, basic_vector2d<T> const &rhs)
 {
   return lhs.x == rhs.x && lhs.y == rhs.y;
 }
 
 // ==========================================================================
-// OPERATOR!=(vector2d,vector2d)
+// OPERATOR!=(basic_vector2d,basic_vector2d)
 // ==========================================================================
-constexpr bool operator!=(vector2d const &lhs, vector2d const &rhs)
+template <class T>
+constexpr bool operator!=(
+    basic_vector2d<T> const &lhs, basic_vector2d<T> const &rhs)
 {
   return !(lhs == rhs);
 }
 
 // ==========================================================================
-// OPERATOR+(vector2d,vector2d)
+// OPERATOR+(basic_vector2d,basic_vector2d)
 // ==========================================================================
-constexpr vector2d operator+(vector2d lhs, vector2d const &rhs)
+template <class T>
+constexpr basic_vector2d<T> operator+(
+    basic_vector2d<T> lhs, basic_vector2d<T> const &rhs)
 {
   return lhs += rhs;
 }
 
 // ==========================================================================
-// OPERATOR-(vector2d,vector2d)
+// OPERATOR-(basic_vector2d,basic_vector2d)
 // ==========================================================================
-constexpr vector2d operator-(vector2d lhs, vector2d const &rhs)
+template <class T>
+constexpr basic_vector2d<T> operator-(
+    basic_vector2d<T> lhs, basic_vector2d<T> const &rhs)
 {
   return lhs -= rhs;
 }
 
 // ==========================================================================
-// OPERATOR*(double,vector2d)
+// OPERATOR*(T,basic_vector2d)
 // ==========================================================================
-constexpr vector2d operator*(double lhs, vector2d const &rhs)
+// The scalar is not deduced, so that, for example, a vector2d may be
+// multiplied by an int.
+template <class T>
+constexpr basic_vector2d<T> operator*(
+    typename basic_vector2d<T>::value_type lhs, basic_vector2d<T> const &rhs)
 {
   return {lhs * rhs.x, lhs * rhs.y};
 }
 
 // ==========================================================================
-// OPERATOR*(vector2d,double)
+// OPERATOR*(basic_vector2d,T)
 // ==========================================================================
-constexpr vector2d operator*(vector2d const &lhs, double rhs)
+template <class T>
+constexpr basic_vector2d<T> operator*(
+    basic_vector2d<T> const &lhs, typename basic_vector2d<T>::value_type rhs)
 {
   return {lhs.x * rhs, lhs.y * rhs};
 }
 
 // ==========================================================================
-// OPERATOR/(vector2d, double)
+// OPERATOR/(basic_vector2d,T)
 // ==========================================================================
-constexpr vector2d operator/(vector2d const &lhs, double rhs)
+template <class T>
+constexpr basic_vector2d<T> operator/(
+    basic_vector2d<T> const &lhs, typename basic_vector2d<T>::value_type rhs)
 {
   return {lhs.x / rhs, lhs.y / rhs};
 }
 
 // ==========================================================================
-// dot(vector2d,vector2d)
+// dot(basic_vector2d,basic_vector2d)
 // ==========================================================================
-constexpr double dot(vector2d const &lhs, vector2d const &rhs)
+template <class T>
+constexpr T dot(basic_vector2d<T> const &lhs, basic_vector2d<T> const &rhs)
 {
   return lhs.x * rhs.x + lhs.y * rhs.y;
 }
 
 // ==========================================================================
-// normalize(vector2d)
+// normalize(basic_vector2d)
 // ==========================================================================
-inline vector2d normalize(vector2d const &v)
+template <class T>
+basic_vector2d<T> normalize(basic_vector2d<T> const &v)
 {
   return v / v.length();
 }
 
+// ==========================================================================
+// vector_cast(basic_vector2d)
+// ==========================================================================
+// Converts a vector to one with co-ordinates of another type.
+template <class To, class From>
+constexpr basic_vector2d<To> vector_cast(basic_vector2d<From> const &v)
+{
+  return {static_cast<To>(v.x), static_cast<To>(v.y)};
+}
+
 }  // namespace textray
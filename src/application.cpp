@@ -1,9 +1,23 @@
 #include "application.hpp"
 #include "client.hpp"
 #include "connection.hpp"
+#include "frame_scheduler.hpp"
+#include "metrics.hpp"
+#include "metrics_reporter.hpp"
+#include "recording.hpp"
+#include "slot_map.hpp"
+#include "tcp_listener.hpp"
+#include "trace.hpp"
 #include <serverpp/tcp_server.hpp>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/format.hpp>
 #include <boost/make_unique.hpp>
-#include <boost/range/algorithm/find_if.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
 #include <utility>
 
 namespace textray {
@@ -17,14 +31,49 @@ struct application::impl
   // ======================================================================
   // CONSTRUCTOR
   // ======================================================================
-  impl(boost::asio::io_context &io_context, serverpp::port_identifier port)
-    : server_(
+  impl(
+      boost::asio::io_context &io_context,
+      serverpp::port_identifier port,
+      settings config)
+    : settings_(config), scheduler_(make_frame_scheduler(settings_))
+  {
+    auto &new_shard =
+        *shards_.emplace_back(boost::make_unique<shard>(io_context));
+    new_shard.server_ = boost::make_unique<serverpp::tcp_server>(
         io_context,
         port,
-        [this](serverpp::tcp_socket &&new_socket)
-        { on_accept(std::move(new_socket)); }),
-      io_context_(io_context)
+        [this, &new_shard](serverpp::tcp_socket &&new_socket)
+        { on_accept(new_shard, std::move(new_socket)); });
+
+    reporter_ =
+        boost::make_unique<metrics_reporter>(io_context, metrics_, settings_);
+    start_trace_dumps(io_context);
+  }
+
+  // ======================================================================
+  // CONSTRUCTOR
+  // ======================================================================
+  impl(
+      std::vector<std::reference_wrapper<boost::asio::io_context>> const
+          &io_contexts,
+      serverpp::port_identifier port,
+      settings config)
+    : settings_(config), scheduler_(make_frame_scheduler(settings_))
   {
+    for (auto &io_context : io_contexts)
+    {
+      auto &new_shard =
+          *shards_.emplace_back(boost::make_unique<shard>(io_context));
+      new_shard.listener_ = boost::make_unique<tcp_listener>(
+          io_context,
+          port,
+          [this, &new_shard](serverpp::tcp_socket &&new_socket)
+          { on_accept(new_shard, std::move(new_socket)); });
+    }
+
+    reporter_ = boost::make_unique<metrics_reporter>(
+        shards_.front()->io_context_, metrics_, settings_);
+    start_trace_dumps(shards_.front()->io_context_);
   }
 
   // ======================================================================
@@ -32,69 +81,237 @@ struct application::impl
   // ======================================================================
   void shutdown()
   {
-    server_.shutdown();
-    close_all_connections();
+    reporter_->shutdown();
+
+    if (trace_signal_)
+    {
+      boost::asio::post(
+          shards_.front()->registry_strand_,
+          [this] { trace_signal_->cancel(); });
+    }
+
+    // Each shard is shut down on its registry's strand, since its listener
+    // and clients are only ever accessed from there.
+    for (auto &each_shard : shards_)
+    {
+      boost::asio::post(
+          each_shard->registry_strand_,
+          [&current_shard = *each_shard]
+          {
+            if (current_shard.server_)
+            {
+              current_shard.server_->shutdown();
+            }
+
+            if (current_shard.listener_)
+            {
+              current_shard.listener_->shutdown();
+            }
+
+            close_all_connections(current_shard);
+          });
+    }
   }
 
  private:
   // ======================================================================
-  // ON_ACCEPT
+  // MAKE_FRAME_SCHEDULER
   // ======================================================================
-  void on_accept(serverpp::tcp_socket &&new_socket)
+  // The frames of every client, in every shard, are rendered by a single
+  // scheduler on threads of its own, so that no client's rendering holds
+  // up the network threads, unless no threads are given to rendering.
+  static std::unique_ptr<frame_scheduler> make_frame_scheduler(
+      settings const &config)
   {
-    auto new_client = boost::make_unique<client>(
-        connection(std::move(new_socket)),
-        io_context_,
-        [this](client const &dead_client)
-        { handle_closed_connection(dead_client); },
-        [this]() { shutdown(); });
-
-    auto clients_lock = std::unique_lock<std::mutex>(clients_mutex_);
-    clients_.push_back(std::move(new_client));
+    return config.render_threads == 0
+               ? nullptr
+               : boost::make_unique<frame_scheduler>(config.render_threads);
   }
 
   // ======================================================================
-  // CLOSE_ALL_CONNECTIONS
+  // SHARD
   // ======================================================================
-  void close_all_connections()
+  // A shard is the set of clients that were accepted by, and whose
+  // handlers are run on, a single io_context.
+  //
+  // A shard's clients are held in a slot map, so that each client can be
+  // added and removed in constant time.  The slot map is only ever
+  // accessed from the shard's registry strand, and so needs no lock:
+  // accepting and disconnecting threads merely post their work to it.
+  struct shard
   {
-    auto clients_lock = std::unique_lock<std::mutex>(clients_mutex_);
-    for (auto &connection : clients_)
+    explicit shard(boost::asio::io_context &io_context)
+      : io_context_(io_context), registry_strand_(io_context)
     {
-      connection->close();
     }
+
+    boost::asio::io_context &io_context_;
+    boost::asio::io_context::strand registry_strand_;
+    std::unique_ptr<serverpp::tcp_server> server_;
+    std::unique_ptr<tcp_listener> listener_;
+
+    slot_map<std::unique_ptr<client>> clients_;
+  };
+
+  using client_key = slot_map<std::unique_ptr<client>>::key;
+
+  // ======================================================================
+  // ON_ACCEPT
+  // ======================================================================
+  void on_accept(shard &owner, serverpp::tcp_socket &&new_socket)
+  {
+    boost::asio::post(
+        owner.registry_strand_,
+        [this, &owner, socket = std::move(new_socket)]() mutable
+        {
+          // The slot is reserved first so that the client's death can be
+          // reported by key.
+          auto const key = owner.clients_.insert(nullptr);
+          auto metrics = metrics_.make_client_metrics();
+          auto cnx = make_connection(std::move(socket), metrics->id);
+
+          *owner.clients_.find(key) = boost::make_unique<client>(
+              std::move(cnx),
+              owner.io_context_,
+              scheduler_.get(),
+              settings_,
+              std::move(metrics),
+              [&owner, key](client const &)
+              { handle_closed_connection(owner, key); },
+              [this]() { shutdown(); });
+        });
   }
 
   // ======================================================================
-  // HANDLE_CLOSED_CONNECTION
+  // START_TRACE_DUMPS
+  // ======================================================================
+  void start_trace_dumps(boost::asio::io_context &io_context)
+  {
+#ifdef TEXTRAY_WITH_TRACING
+    trace_signal_ =
+        boost::make_unique<boost::asio::signal_set>(io_context, SIGUSR1);
+    wait_for_trace_signal();
+#else
+    static_cast<void>(io_context);
+#endif
+  }
+
+  // ======================================================================
+  // WAIT_FOR_TRACE_SIGNAL
+  // ======================================================================
+  void wait_for_trace_signal()
+  {
+#ifdef TEXTRAY_WITH_TRACING
+    // Dumps are handled on the first shard's registry strand, where the
+    // signal set is also cancelled.
+    trace_signal_->async_wait(boost::asio::bind_executor(
+        shards_.front()->registry_strand_,
+        [this](boost::system::error_code const &ec, int)
+        {
+          if (ec)
+          {
+            return;
+          }
+
+          // Each dump is written to a new file in the working directory.
+          auto const filename =
+              (boost::format("textray-trace-%d-%d.json") % start_time_
+               % trace_dumps_++)
+                  .str();
+          std::ofstream out(filename);
+          trace::write_chrome_trace(out);
+          std::cerr << "trace written to " << filename << "\n";
+
+          wait_for_trace_signal();
+        }));
+#endif
+  }
+
   // ======================================================================
-  void handle_closed_connection(client const &dead_client)
+  // MAKE_CONNECTION
+  // ======================================================================
+  connection make_connection(
+      serverpp::tcp_socket &&socket, std::uint64_t client_id) const
   {
-    auto clients_lock = std::unique_lock<std::mutex>(clients_mutex_);
-    auto dead_client_ptr = boost::find_if(
-        clients_,
-        [&dead_client](std::unique_ptr<client> const &current_client)
-        { return &dead_client == current_client.get(); });
+    auto endpoint = make_telnet_endpoint(std::move(socket));
 
-    if (dead_client_ptr != clients_.end())
+    if (!settings_.recording_directory.empty())
     {
-      clients_.erase(dead_client_ptr);
+      // Recordings are named for the time the server started and the
+      // client's id, so that those of successive runs do not collide.
+      endpoint = make_recording_endpoint(
+          std::move(endpoint),
+          (boost::format("%s/%d-%d.rec") % settings_.recording_directory
+           % start_time_ % client_id)
+              .str());
     }
+
+    return connection(std::move(endpoint));
   }
 
-  serverpp::tcp_server server_;
-  boost::asio::io_context &io_context_;
+  // ======================================================================
+  // CLOSE_ALL_CONNECTIONS
+  // ======================================================================
+  static void close_all_connections(shard &owner)
+  {
+    owner.clients_.for_each(
+        [](std::unique_ptr<client> const &current_client)
+        {
+          if (current_client)
+          {
+            current_client->close();
+          }
+        });
+  }
+
+  // ======================================================================
+  // HANDLE_CLOSED_CONNECTION
+  // ======================================================================
+  static void handle_closed_connection(shard &owner, client_key key)
+  {
+    // The client is destroyed in a handler of its own, rather than from
+    // within the callback that reported its death.
+    boost::asio::post(
+        owner.registry_strand_,
+        [&owner, key] { owner.clients_.erase(key); });
+  }
+
+  settings settings_;
+  std::int64_t start_time_{
+      std::chrono::duration_cast<std::chrono::seconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count()};
+  server_metrics metrics_;
 
-  std::mutex clients_mutex_;
-  std::vector<std::unique_ptr<client>> clients_;
+  // The scheduler outlives the clients, whose frames may still be being
+  // rendered as they are destroyed.
+  std::unique_ptr<frame_scheduler> scheduler_;
+  std::vector<std::unique_ptr<shard>> shards_;
+  std::unique_ptr<metrics_reporter> reporter_;
+  std::unique_ptr<boost::asio::signal_set> trace_signal_;
+  int trace_dumps_{0};
 };
 
 // ==========================================================================
 // CONSTRUCTOR
 // ==========================================================================
 application::application(
-    boost::asio::io_context &io_context, serverpp::port_identifier port)
-  : pimpl_(boost::make_unique<impl>(io_context, port))
+    boost::asio::io_context &io_context,
+    serverpp::port_identifier port,
+    settings config)
+  : pimpl_(boost::make_unique<impl>(io_context, port, config))
+{
+}
+
+// ==========================================================================
+// CONSTRUCTOR
+// ==========================================================================
+application::application(
+    std::vector<std::reference_wrapper<boost::asio::io_context>> const
+        &io_contexts,
+    serverpp::port_identifier port,
+    settings config)
+  : pimpl_(boost::make_unique<impl>(io_contexts, port, config))
 {
 }
 
@@ -1,6 +1,16 @@
 #include "client.hpp"
+#include "camera.hpp"
+#include "colour_depth.hpp"
 #include "connection.hpp"
 #include "floorplan.hpp"
+#include "frame_scheduler.hpp"
+#include "lightmap.hpp"
+#include "memory_budget.hpp"
+#include "metrics.hpp"
+#include "render_mode.hpp"
+#include "settings.hpp"
+#include "texture.hpp"
+#include "trace.hpp"
 #include "ui.hpp"
 #include "vector2d.hpp"
 
@@ -9,20 +19,29 @@
 #include <terminalpp/terminal.hpp>
 #include <munin/window.hpp>
 
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
-#include <boost/make_unique.hpp>
+#include <boost/algorithm/cxx11/any_of.hpp>
+#include <boost/range/algorithm/find.hpp>
 #include <boost/range/algorithm/find_if.hpp>
 #include <boost/range/algorithm/for_each.hpp>
+#include <algorithm>
 #include <any>
 #include <atomic>
+#include <chrono>
 #include <cmath>
+#include <memory>
+#include <optional>
 #include <utility>
+#include <variant>
 
 namespace textray {
 
 namespace {
 
-floorplan level_map = {{
+floorplan const level_map = {{
     // clang-format off
  { 1, 1, 2, 2, 3, 3, 4, 4 },
  { 3, 0, 0, 0, 0, 0, 0, 4 },
@@ -36,6 +55,139 @@ floorplan level_map = {{
     // clang-format on
 }};
 
+// ======================================================================
+// APPLY_LEVEL_TEXTURES
+// ======================================================================
+// Dresses two of the level's kinds of wall in textures: the red walls in
+// bricks, and the white walls in blocks of stone.
+void apply_level_textures(floorplan &plan)
+{
+  using terminalpp::true_colour;
+
+  auto const bricks = std::make_shared<texture const>(make_texture(
+      {true_colour{0xA0, 0x3C, 0x28}, true_colour{0xC8, 0xC8, 0xB4}},
+      {"########",
+       "===#====",
+       "########",
+       "=======#",
+       "########",
+       "===#====",
+       "########",
+       "=======#"},
+      {"00000000",
+       "11101111",
+       "00000000",
+       "11111110",
+       "00000000",
+       "11101111",
+       "00000000",
+       "11111110"}));
+
+  auto const stone = std::make_shared<texture const>(make_texture(
+      {true_colour{0xB4, 0xB4, 0xAA}, true_colour{0x6E, 0x6E, 0x64}},
+      {"########",
+       "########",
+       "########",
+       "--------",
+       "####|###",
+       "####|###",
+       "####|###",
+       "--------"},
+      {"00000000",
+       "00000000",
+       "00000000",
+       "11111111",
+       "00001000",
+       "00001000",
+       "00001000",
+       "11111111"}));
+
+  for (auto &row : plan)
+  {
+    for (auto &tile : row)
+    {
+      auto const colour = static_cast<terminalpp::graphics::colour>(
+          tile.fill.glyph_.character_);
+
+      if (colour == terminalpp::graphics::colour::red)
+      {
+        tile.surface = bricks;
+      }
+      else if (colour == terminalpp::graphics::colour::white)
+      {
+        tile.surface = stone;
+      }
+    }
+  }
+}
+
+// ======================================================================
+// MAKE_GRATE
+// ======================================================================
+// Returns the texture of an iron grate, through whose gaps whatever lies
+// beyond it can be seen.
+std::shared_ptr<texture const> make_grate()
+{
+  using terminalpp::true_colour;
+
+  return std::make_shared<texture const>(make_texture(
+      {true_colour{0x50, 0x50, 0x58}},
+      {"#  #  #  ",
+       "#########",
+       "#  #  #  ",
+       "#  #  #  ",
+       "#########",
+       "#  #  #  "},
+      {"000000000",
+       "000000000",
+       "000000000",
+       "000000000",
+       "000000000",
+       "000000000"}));
+}
+
+// ======================================================================
+// SHARED_LEVEL_MAP
+// ======================================================================
+// Every client explores the same level, which is never modified, so a
+// single copy of it is shared between them all.
+std::shared_ptr<floorplan> const &shared_level_map()
+{
+  static auto const plan = []
+  {
+    auto level = std::make_shared<floorplan>(level_map);
+    apply_level_textures(*level);
+
+    // The pillar in the middle of the level stands only to waist height,
+    // so that the walls behind it can be seen over it.
+    (*level)[2][4].height = 0.5;
+
+    // The pillar near the south wall is an iron grate, through which the
+    // walls behind it can be seen.
+    auto &grate = (*level)[6][3];
+    grate.surface = make_grate();
+    grate.see_through = true;
+
+    return level;
+  }();
+
+  return plan;
+}
+
+// ======================================================================
+// SHARED_LEVEL_LIGHTING
+// ======================================================================
+// The level's lights are as static as the level itself, so they are baked
+// once and shared between every client.
+std::shared_ptr<lightmap const> const &shared_level_lighting()
+{
+  static auto const lighting = std::make_shared<lightmap const>(
+      *shared_level_map(),
+      std::vector<light>{{{2.5, 1.5}, 60, 4}, {{5.5, 6.5}, 80, 5}});
+
+  return lighting;
+}
+
 // ======================================================================
 // TO_RADIANS
 // ======================================================================
@@ -44,12 +196,15 @@ constexpr double to_radians(double angle_degrees)
   return angle_degrees * M_PI / 180;
 }
 
+// The distance moved by a single movement keypress.
+constexpr double velocity = 0.25;
+
 }  // namespace
 
 // ==========================================================================
 // CLIENT IMPLEMENTATION STRUCTURE
 // ==========================================================================
-class client::impl  // NOLINT
+class client::impl : public std::enable_shared_from_this<client::impl>  // NOLINT
 {
  public:
   // ======================================================================
@@ -58,16 +213,24 @@ class client::impl  // NOLINT
   impl(
       connection &&cnx,
       boost::asio::io_context &io_context,
+      frame_scheduler *scheduler,
+      settings const &config,
+      std::shared_ptr<client_metrics> metrics,
       std::function<void()> connection_died,
       std::function<void()> shutdown)
     : connection_{std::move(cnx)},
-      channel_{connection_},
+      channel_{connection_, config.max_input_buffer, metrics},
       terminal_{channel_, create_behaviour()},
       strand_(io_context),
+      scheduler_(scheduler),
+      tick_timer_(io_context),
+      tick_interval_(config.tick_interval),
+      settings_(config),
+      metrics_(std::move(metrics)),
       connection_died_(std::move(connection_died)),
       shutdown_(std::move(shutdown)),
       canvas_({80, 24}),
-      floorplan_(std::make_shared<floorplan>(level_map)),
+      floorplan_(shared_level_map()),
       position_({3, 2}),
       heading_(to_radians(210)),
       fov_(90),
@@ -75,29 +238,65 @@ class client::impl  // NOLINT
           floorplan_, position_, heading_, to_radians(fov_))),
       window_(terminal_, ui_),
       repaint_requested_(false)
+  {
+    connection_.set_metrics(metrics_);
+    ui_->set_camera_metrics(metrics_);
+    ui_->set_camera_panorama_enabled(config.panorama);
+    ui_->set_camera_render_precision(config.precision);
+    ui_->set_camera_column_stride(config.column_stride);
+    ui_->set_camera_lighting(shared_level_lighting());
+    metrics_->memory_bytes = estimated_client_memory(canvas_.size(), settings_);
+  }
+
+  // ======================================================================
+  // START
+  // ======================================================================
+  // Begins handling the connection.  This is separate from the
+  // constructor since the handlers that it installs refer to the client
+  // weakly, which requires it to be owned by a shared_ptr.
+  void start()
   {
     terminal_ << terminalpp::hide_cursor();
     terminal_ << terminalpp::enable_mouse();
 
     connection_.async_get_terminal_type(
-        [](std::string const &terminal_type)
+        [this](std::string const &terminal_type)
         {
           std::cout << "connection from terminal: " << terminal_type << "\n";
+          post_to_strand([terminal_type](impl &self)
+                         { self.terminal_type_detected(terminal_type); });
         });
 
     connection_.on_window_size_changed(
-        [&](std::uint16_t width, std::uint16_t height)
+        [this](std::uint16_t width, std::uint16_t height)
         {
-          window_width_ = width;
-          window_height_ = height;
-          window_size_changed(width, height);
+          post_to_strand(
+              [width, height](impl &self)
+              {
+                self.window_width_ = width;
+                self.window_height_ = height;
+                self.window_size_changed(width, height);
+              });
         });
 
+    // Repaints are not performed immediately, but are deferred to the
+    // next tick so that any number of requests between ticks result in
+    // at most one frame.
     window_.on_repaint_request.connect(
         [this]
         {
-          repaint_requested_ = true;
-          boost::asio::post(strand_, [this] { on_repaint(); });
+          ++metrics_->repaint_requests;
+
+          if (repaint_requested_.exchange(true))
+          {
+            ++metrics_->repaints_coalesced;
+          }
+          else
+          {
+            repaint_requested_at_.mark();
+          }
+
+          post_to_strand([](impl &self) { self.schedule_tick(); });
         });
     window_.on_repaint_request();
 
@@ -106,6 +305,7 @@ class client::impl  // NOLINT
 
   ~impl()
   {
+    tick_timer_.cancel();
     terminal_ << terminalpp::disable_mouse();
     terminal_ << terminalpp::show_cursor();
   }
@@ -116,6 +316,25 @@ class client::impl  // NOLINT
   }
 
  private:
+  // ======================================================================
+  // POST_TO_STRAND
+  // ======================================================================
+  // Posts a function to be called with this client on its strand.  The
+  // call is abandoned if the client has been destroyed in the meantime.
+  template <class Function>
+  void post_to_strand(Function &&fn)
+  {
+    boost::asio::post(
+        strand_,
+        [weak_self = weak_from_this(), fn = std::forward<Function>(fn)]()
+        {
+          if (auto self = weak_self.lock())
+          {
+            fn(*self);
+          }
+        });
+  }
+
   // ======================================================================
   // SCHEDULE_NEXT_READ
   // ======================================================================
@@ -124,67 +343,391 @@ class client::impl  // NOLINT
     terminal_.async_read(
         [this](terminalpp::tokens data)
         {
-          for (auto const &token : data)
-          {
-            std::visit([this](auto const &ev) { event(ev); }, token);
-          }
+          auto const arrival_time = std::chrono::steady_clock::now();
+
+          // Input is handled on the strand so that it is serialised with
+          // the ticks that apply it.
+          post_to_strand(
+              [data = std::move(data), arrival_time](impl &self)
+              {
+                TEXTRAY_TRACE_SPAN("event dispatch");
+                self.metrics_->input_tokens += data.size();
+                self.note_input_arrival(data, arrival_time);
+
+                for (auto const &token : data)
+                {
+                  std::visit(
+                      [&self](auto const &ev) { self.event(ev); }, token);
+                }
+
+                // A keypress that caused no work will cause no frame, and
+                // so is not timed.
+                if (!self.has_pending_work())
+                {
+                  self.unanswered_keypress_time_.reset();
+                }
+
+                self.schedule_tick();
+              });
 
           if (terminal_.is_alive())
           {
             schedule_next_read();
           }
+          else
+          {
+            // The death is reported on the strand, after any input that
+            // was already posted there has been handled.
+            post_to_strand([](impl &self) { self.connection_died_(); });
+          }
         });
   }
 
   // ======================================================================
-  // WINDOW_SIZE_CHANGED
+  // NOTE_INPUT_ARRIVAL
   // ======================================================================
-  void window_size_changed(std::uint16_t width, std::uint16_t height)
+  void note_input_arrival(
+      terminalpp::tokens const &data,
+      std::chrono::steady_clock::time_point arrival_time)
   {
-    if (canvas_.size() != terminalpp::extent{width, height})
+    // Only the earliest keypress that has not yet been answered by a
+    // frame is timed, since that is the one whose latency is felt.
+    if (!unanswered_keypress_time_
+        && boost::algorithm::any_of(
+            data,
+            [](auto const &token)
+            { return std::holds_alternative<terminalpp::virtual_key>(token); }))
     {
-      canvas_ = terminalpp::canvas({width, height});
-      terminal_.set_size({width, height});
+      unanswered_keypress_time_ = arrival_time;
     }
+  }
 
-    window_.on_repaint_request();
+  // ======================================================================
+  // HAS_PENDING_WORK
+  // ======================================================================
+  [[nodiscard]] bool has_pending_work() const
+  {
+    return repaint_requested_ || pending_rotation_ != 0.0
+           || pending_displacement_ != vector2d{};
   }
 
   // ======================================================================
-  // MOVE_DIRECTION
+  // HAS_WORK_FOR_TICK
   // ======================================================================
-  void move_direction(double angle)
+  // A repaint waits for any frame that is still being rendered, whose
+  // arrival schedules the tick that performs it.
+  [[nodiscard]] bool has_work_for_tick() const
+  {
+    return (repaint_requested_ && !frame_in_flight_)
+           || pending_rotation_ != 0.0 || pending_displacement_ != vector2d{};
+  }
+
+  // ======================================================================
+  // SCHEDULE_TICK
+  // ======================================================================
+  void schedule_tick()
+  {
+    if (tick_scheduled_ || !has_work_for_tick())
+    {
+      return;
+    }
+
+    // A tick that follows a period of inactivity happens immediately, so
+    // that isolated keypresses are not delayed.  Otherwise, ticks are
+    // spaced at least one interval apart.
+    tick_scheduled_ = true;
+    tick_timer_.expires_at(std::max(
+        std::chrono::steady_clock::now(), last_tick_ + tick_interval_));
+    tick_timer_.async_wait(boost::asio::bind_executor(
+        strand_,
+        [weak_self = weak_from_this()](boost::system::error_code const &ec)
+        {
+          if (auto self = weak_self.lock(); self && !ec)
+          {
+            self->tick();
+          }
+        }));
+  }
+
+  // ======================================================================
+  // TICK
+  // ======================================================================
+  void tick()
+  {
+    last_tick_ = std::chrono::steady_clock::now();
+    ++metrics_->ticks;
+
+    integrate_movement();
+
+    bool b = true;
+    if (!frame_in_flight_
+        && repaint_requested_.compare_exchange_strong(b, false))
+    {
+      // There is no point in rendering a frame that can never be seen.
+      repaint_requested_at_.record_since("repaint scheduling delay");
+
+      if (!terminal_.is_alive())
+      {
+        ++metrics_->frames_dropped;
+      }
+      else if (scheduler_ != nullptr)
+      {
+        schedule_frame(
+            std::exchange(unanswered_keypress_time_, std::nullopt));
+      }
+      else
+      {
+        TEXTRAY_TRACE_SPAN("window repaint");
+        window_.repaint(canvas_);
+        frame_sent(unanswered_keypress_time_);
+      }
+    }
+
+    // A keypress that caused no frame in this tick, and whose frame is not
+    // waiting for another to be rendered, caused none at all, and so is not
+    // timed.
+    if (!repaint_requested_)
+    {
+      unanswered_keypress_time_.reset();
+    }
+
+    tick_scheduled_ = false;
+    schedule_tick();
+  }
+
+  // ======================================================================
+  // SCHEDULE_FRAME
+  // ======================================================================
+  // Submits the camera's view to the frame scheduler, so that rendering
+  // never holds up the handling of this or any other client's input.  The
+  // frame is then handed back to the strand to be drawn and sent, or, if
+  // the scheduler stops before rendering it, to be given up.  Only the
+  // strand, which outlives the client, is used from the scheduler, since
+  // the client may be destroyed while its frame is rendered.
+  void schedule_frame(
+      std::optional<std::chrono::steady_clock::time_point> keypress_time)
   {
-    static constexpr auto velocity = 0.25;
+    frame_in_flight_ = true;
+
+    // A frame that answers a keypress is already late, and so is due when
+    // the key was pressed.  Any other is due a tick after the client's
+    // last frame, so that those clients that have waited longest for a
+    // frame are served first.
+    auto const submitted = std::chrono::steady_clock::now();
+    auto const deadline =
+        keypress_time ? *keypress_time : last_frame_at_ + tick_interval_;
+
+    scheduler_->submit(
+        {deadline,
+         metrics_->id,
+         [render = ui_->prepare_camera_frame(),
+          strand = strand_,
+          weak_self = weak_from_this(),
+          metrics = metrics_,
+          submitted,
+          keypress_time]
+         {
+           metrics->frame_wait_us.record(
+               std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now() - submitted)
+                   .count());
+
+           auto frame = render();
 
-    auto const proposed_position =
-        position_ + vector2d::from_angle(angle) * velocity;
+           boost::asio::post(
+               strand,
+               [weak_self, frame = std::move(frame), keypress_time]() mutable
+               {
+                 if (auto self = weak_self.lock())
+                 {
+                   self->frame_rendered(std::move(frame), keypress_time);
+                 }
+               });
+         },
+         [strand = strand_, weak_self = weak_from_this()]
+         {
+           boost::asio::post(
+               strand,
+               [weak_self]
+               {
+                 if (auto self = weak_self.lock())
+                 {
+                   self->frame_cancelled();
+                 }
+               });
+         }});
+  }
 
+  // ======================================================================
+  // FRAME_RENDERED
+  // ======================================================================
+  void frame_rendered(
+      camera_frame frame,
+      std::optional<std::chrono::steady_clock::time_point> keypress_time)
+  {
+    frame_in_flight_ = false;
+
+    if (terminal_.is_alive())
+    {
+      TEXTRAY_TRACE_SPAN("window repaint");
+      ui_->set_camera_frame(std::move(frame));
+      window_.repaint(canvas_);
+      frame_sent(keypress_time);
+    }
+    else
+    {
+      ++metrics_->frames_dropped;
+    }
+
+    schedule_tick();
+  }
+
+  // ======================================================================
+  // FRAME_CANCELLED
+  // ======================================================================
+  // The scheduler stopped before rendering the frame, and so the server is
+  // stopping.  No further frame is scheduled.
+  void frame_cancelled()
+  {
+    frame_in_flight_ = false;
+    ++metrics_->frames_dropped;
+  }
+
+  // ======================================================================
+  // FRAME_SENT
+  // ======================================================================
+  void frame_sent(
+      std::optional<std::chrono::steady_clock::time_point> keypress_time)
+  {
+    ++metrics_->frames;
+    last_frame_at_ = std::chrono::steady_clock::now();
+
+    // The repaint writes the whole frame synchronously, so by now its last
+    // byte has been handed to the socket.
+    if (keypress_time)
+    {
+      metrics_->input_latency_us.record(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - *keypress_time)
+              .count());
+    }
+  }
+
+  // ======================================================================
+  // INTEGRATE_MOVEMENT
+  // ======================================================================
+  void integrate_movement()
+  {
+    if (pending_rotation_ == 0.0 && pending_displacement_ == vector2d{})
+    {
+      return;
+    }
+
+    heading_ += pending_rotation_;
+    pending_rotation_ = 0.0;
+
+    // The accumulated displacement is applied in steps no longer than a
+    // single movement so that a flood of input cannot carry the camera
+    // through a wall.  Movement stops at the first step that is blocked.
+    auto const distance = pending_displacement_.length();
+    auto const steps = static_cast<int>(std::ceil(distance / velocity));
+    auto const step = steps == 0 ? vector2d{} : pending_displacement_ / steps;
+    pending_displacement_ = {};
+
+    for (int i = 0; i < steps; ++i)
+    {
+      auto const proposed_position = position_ + step;
+
+      if (!is_in_valid_space(proposed_position))
+      {
+        break;
+      }
+
+      position_ = proposed_position;
+    }
+
+    ui_->move_camera_to(position_, heading_);
+  }
+
+  // ======================================================================
+  // IS_IN_VALID_SPACE
+  // ======================================================================
+  [[nodiscard]] bool is_in_valid_space(vector2d const &proposed_position) const
+  {
     bool const proposal_is_within_bounds =
         proposed_position.x >= 0
         && proposed_position.x < (*floorplan_)[0].size()
         && proposed_position.y >= 0
         && proposed_position.y < (*floorplan_).size();
 
-    bool const proposal_is_in_valid_space =
-        proposal_is_within_bounds
-        && (*floorplan_)[proposed_position.y][proposed_position.x]
-                   .fill.glyph_.character_
-               == 0;
+    return proposal_is_within_bounds
+           && (*floorplan_)[proposed_position.y][proposed_position.x]
+                      .fill.glyph_.character_
+                  == 0;
+  }
 
-    if (proposal_is_in_valid_space)
+  // ======================================================================
+  // WINDOW_SIZE_CHANGED
+  // ======================================================================
+  void window_size_changed(std::uint16_t width, std::uint16_t height)
+  {
+    // A client may report any window size at all, so the size that is
+    // actually rendered is limited to keep the client within its budget.
+    auto const requested_size = terminalpp::extent{width, height};
+    auto const size = clamp_window_size(requested_size, settings_);
+
+    if (size != requested_size)
     {
-      position_ = proposed_position;
-      ui_->move_camera_to(position_, heading_);
+      ++metrics_->window_clamps;
+    }
+
+    if (canvas_.size() != size)
+    {
+      canvas_ = terminalpp::canvas(size);
+      terminal_.set_size(size);
+      metrics_->memory_bytes = estimated_client_memory(size, settings_);
+    }
+
+    window_.on_repaint_request();
+  }
+
+  // ======================================================================
+  // TERMINAL_TYPE_DETECTED
+  // ======================================================================
+  void terminal_type_detected(std::string const &terminal_type)
+  {
+    // A colour depth explicitly chosen by the user takes precedence over
+    // one inferred from the terminal type.
+    if (!colour_depth_overridden_)
+    {
+      colour_depth_ = colour_depth_for_terminal_type(terminal_type);
+      ui_->set_camera_colour_depth(colour_depth_);
     }
   }
 
+  // ======================================================================
+  // MOVE_DIRECTION
+  // ======================================================================
+  void move_direction(double angle)
+  {
+    // Movement is accumulated until the next tick.
+    pending_displacement_ += vector2d::from_angle(angle) * velocity;
+  }
+
+  // ======================================================================
+  // PENDING_HEADING
+  // ======================================================================
+  [[nodiscard]] double pending_heading() const
+  {
+    return heading_ + pending_rotation_;
+  }
+
   // ======================================================================
   // MOVE_FORWARD
   // ======================================================================
   void move_forward()
   {
-    move_direction(heading_);
+    move_direction(pending_heading());
   }
 
   // ======================================================================
@@ -192,7 +735,7 @@ class client::impl  // NOLINT
   // ======================================================================
   void move_backward()
   {
-    move_direction(heading_ + M_PI);
+    move_direction(pending_heading() + M_PI);
   }
 
   // ======================================================================
@@ -200,7 +743,7 @@ class client::impl  // NOLINT
   // ======================================================================
   void move_left()
   {
-    move_direction(heading_ + M_PI / 2);
+    move_direction(pending_heading() + M_PI / 2);
   }
 
   // ======================================================================
@@ -208,7 +751,7 @@ class client::impl  // NOLINT
   // ======================================================================
   void move_right()
   {
-    move_direction(heading_ - M_PI / 2);
+    move_direction(pending_heading() - M_PI / 2);
   }
 
   // ======================================================================
@@ -216,8 +759,7 @@ class client::impl  // NOLINT
   // ======================================================================
   void rotate_left()
   {
-    heading_ += to_radians(15);
-    ui_->move_camera_to(position_, heading_);
+    pending_rotation_ += to_radians(15);
   }
 
   // ======================================================================
@@ -225,8 +767,7 @@ class client::impl  // NOLINT
   // ======================================================================
   void rotate_right()
   {
-    heading_ -= to_radians(15);
-    ui_->move_camera_to(position_, heading_);
+    pending_rotation_ -= to_radians(15);
   }
 
   // ======================================================================
@@ -256,6 +797,43 @@ class client::impl  // NOLINT
     ui_->set_camera_fov(to_radians(fov_));
   }
 
+  // ======================================================================
+  // CYCLE_COLOUR_DEPTH
+  // ======================================================================
+  void cycle_colour_depth()
+  {
+    colour_depth_ = next_colour_depth(colour_depth_);
+    colour_depth_overridden_ = true;
+    ui_->set_camera_colour_depth(colour_depth_);
+  }
+
+  // ======================================================================
+  // CYCLE_SHADE_BANDS
+  // ======================================================================
+  void cycle_shade_bands()
+  {
+    // Cycle from continuous shading through progressively coarser bands,
+    // trading smoothness of shading for fewer bytes per frame.
+    static constexpr int shade_bands[] = {0, 16, 8, 4};
+
+    auto const *current = boost::find(shade_bands, shade_bands_);
+    auto const *next = current + 1 < std::end(shade_bands)
+                           ? current + 1
+                           : std::begin(shade_bands);
+
+    shade_bands_ = *next;
+    ui_->set_camera_shade_bands(shade_bands_);
+  }
+
+  // ======================================================================
+  // CYCLE_RENDER_MODE
+  // ======================================================================
+  void cycle_render_mode()
+  {
+    render_mode_ = next_render_mode(render_mode_);
+    ui_->set_camera_render_mode(render_mode_);
+  }
+
   // ======================================================================
   // QUIT
   // ======================================================================
@@ -291,6 +869,9 @@ class client::impl  // NOLINT
         {terminalpp::vk::lowercase_z, &impl::zoom_in},
         {terminalpp::vk::lowercase_x, &impl::zoom_out},
         {terminalpp::vk::lowercase_c, &impl::reset_zoom},
+        {terminalpp::vk::lowercase_v, &impl::cycle_colour_depth},
+        {terminalpp::vk::lowercase_b, &impl::cycle_shade_bands},
+        {terminalpp::vk::lowercase_m, &impl::cycle_render_mode},
         {terminalpp::vk::uppercase_q, &impl::quit},
         {terminalpp::vk::uppercase_p, &impl::shutdown},
     };
@@ -356,19 +937,16 @@ class client::impl  // NOLINT
     return {reinterpret_cast<char const *>(data.data()), data.size()};
   }
 
-  void on_repaint()
-  {
-    bool b = true;
-    if (repaint_requested_.compare_exchange_strong(b, false))
-    {
-      window_.repaint(canvas_);
-    }
-  }
-
   class connection_channel
   {
    public:
-    explicit connection_channel(connection &cnx) : connection_(cnx)
+    connection_channel(
+        connection &cnx,
+        std::size_t max_cache_size,
+        std::shared_ptr<client_metrics> metrics)
+      : connection_(cnx),
+        max_cache_size_(max_cache_size),
+        metrics_(std::move(metrics))
     {
     }
 
@@ -376,9 +954,22 @@ class client::impl  // NOLINT
     {
       connection_.async_read(
           [this](serverpp::bytes data)
-          { cache_.append(data.begin(), data.end()); },
+          {
+            // Input beyond the cap is discarded rather than buffered, so
+            // that a client that floods the server cannot exhaust its
+            // memory.
+            auto const space =
+                max_cache_size_ - std::min(max_cache_size_, cache_.size());
+            auto const kept = std::min(space, data.size());
+
+            cache_.append(data.begin(), data.begin() + kept);
+            metrics_->input_bytes_discarded += data.size() - kept;
+          },
           [=, this]()
           {
+            // The terminal decodes the data into tokens before calling
+            // the client back.
+            TEXTRAY_TRACE_SPAN("input decode");
             serverpp::byte_storage callback_data;
             std::swap(cache_, callback_data);
             callback(callback_data);
@@ -402,12 +993,23 @@ class client::impl  // NOLINT
 
    private:
     connection &connection_;
+    std::size_t max_cache_size_;
+    std::shared_ptr<client_metrics> metrics_;
     serverpp::byte_storage cache_;
   };
 
   connection connection_;
   connection_channel channel_;
   boost::asio::io_context::strand strand_;
+  frame_scheduler *scheduler_;
+  bool frame_in_flight_{false};
+  std::chrono::steady_clock::time_point last_frame_at_;
+  boost::asio::steady_timer tick_timer_;
+  std::chrono::steady_clock::duration tick_interval_;
+  settings settings_;
+  std::chrono::steady_clock::time_point last_tick_;
+  bool tick_scheduled_{false};
+  std::shared_ptr<client_metrics> metrics_;
   std::function<void()> shutdown_;
   std::function<void()> connection_died_;
   terminalpp::terminal terminal_;
@@ -417,6 +1019,12 @@ class client::impl  // NOLINT
   vector2d position_;
   double heading_;
   double fov_;
+  double pending_rotation_{0.0};
+  vector2d pending_displacement_;
+  colour_depth colour_depth_{colour_depth::true_colour};
+  bool colour_depth_overridden_{false};
+  int shade_bands_{0};
+  render_mode render_mode_{render_mode::cells};
 
   std::uint16_t window_width_{80};
   std::uint16_t window_height_{24};
@@ -425,6 +1033,9 @@ class client::impl  // NOLINT
   munin::window window_;
 
   std::atomic<bool> repaint_requested_;
+  trace::timestamp repaint_requested_at_;
+  std::optional<std::chrono::steady_clock::time_point>
+      unanswered_keypress_time_;
 };
 
 // ==========================================================================
@@ -433,15 +1044,22 @@ class client::impl  // NOLINT
 client::client(
     connection &&cnx,
     boost::asio::io_context &io_context,
+    frame_scheduler *scheduler,
+    settings const &config,
+    std::shared_ptr<client_metrics> metrics,
     std::function<void(client const &)> const &connection_died,
     std::function<void()> const &shutdown)
   : pimpl_(
-        boost::make_unique<impl>(
+        std::make_shared<impl>(
             std::move(cnx),
             io_context,
+            scheduler,
+            config,
+            std::move(metrics),
             [this, connection_died]() { connection_died(*this); },
             shutdown))
 {
+  pimpl_->start();
 }
 
 // ==========================================================================
@@ -0,0 +1,91 @@
+#include "colour_depth.hpp"
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+namespace textray {
+
+namespace {
+
+// ==========================================================================
+// CONTAINS
+// ==========================================================================
+bool contains(std::string const &text, std::string_view fragment)
+{
+  return text.find(fragment) != std::string::npos;
+}
+
+}  // namespace
+
+// ==========================================================================
+// COLOUR_DEPTH_FOR_TERMINAL_TYPE
+// ==========================================================================
+colour_depth colour_depth_for_terminal_type(std::string_view terminal_type)
+{
+  // Terminal types are reported in any case (MUD clients in particular
+  // tend to report them in upper case), so compare them case-insensitively.
+  std::string type(terminal_type.begin(), terminal_type.end());
+  std::transform(
+      type.begin(),
+      type.end(),
+      type.begin(),
+      [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+
+  static constexpr std::string_view true_colour_types[] = {
+      "truecolor",
+      "24bit",
+      "-direct",
+      "kitty",
+      "alacritty",
+      "iterm",
+      "wezterm",
+      "foot",
+      "contour"};
+
+  static constexpr std::string_view high_colour_types[] = {
+      "256", "xterm", "screen", "tmux", "rxvt", "putty", "mintty"};
+
+  static constexpr std::string_view low_colour_types[] = {
+      "ansi", "linux", "vt1", "vt2", "cygwin", "dumb"};
+
+  auto const matches = [&type](auto const &fragments)
+  {
+    return std::any_of(
+        std::begin(fragments),
+        std::end(fragments),
+        [&type](std::string_view fragment)
+        { return contains(type, fragment); });
+  };
+
+  // A terminal that is not recognised is given the 256-colour palette,
+  // which nearly every modern terminal supports, rather than true colour,
+  // which is both the most expensive to send and the least likely to be
+  // supported.
+  return matches(true_colour_types)  ? colour_depth::true_colour
+         : matches(high_colour_types) ? colour_depth::high_colour
+         : matches(low_colour_types)  ? colour_depth::low_colour
+                                      : colour_depth::high_colour;
+}
+
+// ==========================================================================
+// NEXT_COLOUR_DEPTH
+// ==========================================================================
+colour_depth next_colour_depth(colour_depth depth)
+{
+  switch (depth)
+  {
+    case colour_depth::true_colour:
+      return colour_depth::high_colour;
+
+    case colour_depth::high_colour:
+      return colour_depth::low_colour;
+
+    case colour_depth::low_colour:
+      return colour_depth::greyscale;
+
+    default:
+      return colour_depth::true_colour;
+  }
+}
+
+}  // namespace textray
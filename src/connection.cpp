@@ -1,4 +1,6 @@
 #include "connection.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
 #include <telnetpp/options/echo/server.hpp>
 #include <telnetpp/options/mccp/codec.hpp>
 #include <telnetpp/options/mccp/server.hpp>
@@ -9,22 +11,27 @@
 #include <telnetpp/telnetpp.hpp>
 #include <serverpp/tcp_socket.hpp>
 #include <boost/make_unique.hpp>
+#include <utility>
 
 namespace textray {
 
+namespace {
+
 // ==========================================================================
-// CONNECTION::IMPLEMENTATION STRUCTURE
+// TELNET_ENDPOINT
 // ==========================================================================
-struct connection::impl
+class telnet_endpoint final : public connection_endpoint
 {
+ public:
   // ======================================================================
   // CONSTRUCTOR
   // ======================================================================
-  explicit impl(serverpp::tcp_socket &&socket) : socket_(std::move(socket))
+  explicit telnet_endpoint(serverpp::tcp_socket &&socket)
+    : socket_(std::move(socket)), channel_(socket_, metrics_)
   {
     telnet_naws_client_.on_window_size_changed.connect(
         [this](auto &&width, auto &&height)
-        { this->on_window_size_changed(width, height); });
+        { this->window_size_changed(width, height); });
 
     telnet_terminal_type_client_.on_terminal_type.connect(
         [this](auto &&type)
@@ -68,7 +75,7 @@ struct connection::impl
   // ======================================================================
   // IS_ALIVE
   // ======================================================================
-  [[nodiscard]] bool is_alive() const
+  [[nodiscard]] bool is_alive() const override
   {
     return socket_.is_alive();
   }
@@ -76,7 +83,7 @@ struct connection::impl
   // ======================================================================
   // CLOSE
   // ======================================================================
-  void close()
+  void close() override
   {
     socket_.close();
   }
@@ -84,8 +91,15 @@ struct connection::impl
   // ======================================================================
   // WRITE
   // ======================================================================
-  void write(telnetpp::element const &data)
+  void write(serverpp::bytes data) override
   {
+    TEXTRAY_TRACE_SPAN("telnet encode");
+
+    if (metrics_)
+    {
+      metrics_->bytes_written += data.size();
+    }
+
     telnet_session_.write(data);
   }
 
@@ -94,7 +108,7 @@ struct connection::impl
   // ======================================================================
   void async_read(
       std::function<void(serverpp::bytes)> const &data_continuation,
-      std::function<void()> const &read_complete_continuation)
+      std::function<void()> const &read_complete_continuation) override
   {
     telnet_session_.async_read(
         [=](telnetpp::bytes data)
@@ -110,10 +124,38 @@ struct connection::impl
         });
   }
 
+  // ======================================================================
+  // ASYNC_GET_TERMINAL_TYPE
+  // ======================================================================
+  void async_get_terminal_type(
+      std::function<void(std::string const &)> const &continuation) override
+  {
+    terminal_type_requests_.emplace_back(continuation);
+  }
+
   // ======================================================================
   // ON_WINDOW_SIZE_CHANGED
   // ======================================================================
-  void on_window_size_changed(std::uint16_t width, std::uint16_t height) const
+  void on_window_size_changed(
+      std::function<void(std::uint16_t, std::uint16_t)> const &continuation)
+      override
+  {
+    on_window_size_changed_ = continuation;
+  }
+
+  // ======================================================================
+  // SET_METRICS
+  // ======================================================================
+  void set_metrics(std::shared_ptr<client_metrics> metrics) override
+  {
+    metrics_ = std::move(metrics);
+  }
+
+ private:
+  // ======================================================================
+  // WINDOW_SIZE_CHANGED
+  // ======================================================================
+  void window_size_changed(std::uint16_t width, std::uint16_t height) const
   {
     if (on_window_size_changed_)
     {
@@ -143,9 +185,60 @@ struct connection::impl
     terminal_type_requests_.clear();
   }
 
+  // ======================================================================
+  // COUNTING_CHANNEL
+  // ======================================================================
+  // The channel through which the Telnet session reaches the socket.  It
+  // counts the bytes that are actually sent, which, once MCCP is active,
+  // are compressed.
+  class counting_channel
+  {
+   public:
+    counting_channel(
+        serverpp::tcp_socket &socket,
+        std::shared_ptr<client_metrics> const &metrics)
+      : socket_(socket), metrics_(metrics)
+    {
+    }
+
+    template <class Continuation>
+    void async_read(Continuation &&continuation)
+    {
+      socket_.async_read(std::forward<Continuation>(continuation));
+    }
+
+    void write(serverpp::bytes data)
+    {
+      TEXTRAY_TRACE_SPAN("socket write");
+
+      if (metrics_)
+      {
+        metrics_->bytes_sent += data.size();
+      }
+
+      socket_.write(data);
+    }
+
+    bool is_alive() const
+    {
+      return socket_.is_alive();
+    }
+
+    void close()
+    {
+      socket_.close();
+    }
+
+   private:
+    serverpp::tcp_socket &socket_;
+    std::shared_ptr<client_metrics> const &metrics_;
+  };
+
   serverpp::tcp_socket socket_;
+  std::shared_ptr<client_metrics> metrics_;
+  counting_channel channel_;
 
-  telnetpp::session telnet_session_{socket_};
+  telnetpp::session telnet_session_{channel_};
   telnetpp::options::echo::server telnet_echo_server_{telnet_session_};
   telnetpp::options::suppress_ga::server telnet_suppress_ga_server_{
       telnet_session_};
@@ -162,11 +255,30 @@ struct connection::impl
   std::vector<std::function<void(std::string)>> terminal_type_requests_;
 };
 
+}  // namespace
+
+// ==========================================================================
+// MAKE_TELNET_ENDPOINT
+// ==========================================================================
+std::unique_ptr<connection_endpoint> make_telnet_endpoint(
+    serverpp::tcp_socket &&socket)
+{
+  return boost::make_unique<telnet_endpoint>(std::move(socket));
+}
+
 // ==========================================================================
 // CONSTRUCTOR
 // ==========================================================================
 connection::connection(serverpp::tcp_socket &&new_socket)
-  : pimpl_(boost::make_unique<impl>(std::move(new_socket)))
+  : pimpl_(make_telnet_endpoint(std::move(new_socket)))
+{
+}
+
+// ==========================================================================
+// CONSTRUCTOR
+// ==========================================================================
+connection::connection(std::unique_ptr<connection_endpoint> endpoint)
+  : pimpl_(std::move(endpoint))
 {
 }
 
@@ -225,7 +337,7 @@ void connection::write(serverpp::bytes data)
 void connection::async_get_terminal_type(
     std::function<void(std::string const &)> const &continuation)
 {
-  pimpl_->terminal_type_requests_.emplace_back(continuation);
+  pimpl_->async_get_terminal_type(continuation);
 }
 
 // ==========================================================================
@@ -234,7 +346,15 @@ void connection::async_get_terminal_type(
 void connection::on_window_size_changed(
     std::function<void(std::uint16_t, std::uint16_t)> const &continuation)
 {
-  pimpl_->on_window_size_changed_ = continuation;
+  pimpl_->on_window_size_changed(continuation);
+}
+
+// ==========================================================================
+// SET_METRICS
+// ==========================================================================
+void connection::set_metrics(std::shared_ptr<client_metrics> metrics)
+{
+  pimpl_->set_metrics(std::move(metrics));
 }
 
 }  // namespace textray
@@ -0,0 +1,465 @@
+#include "frame_scheduler.hpp"
+#include "trace.hpp"
+#include <boost/make_unique.hpp>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace textray {
+
+namespace {
+
+// ==========================================================================
+// WORK_DEQUE
+// ==========================================================================
+// A work-stealing deque of frames, after Chase and Lev, in the form given
+// by Le, Pop, Cohen and Zappa Nardelli.  Only its owner pushes and pops at
+// its bottom, without taking a lock; any other worker may steal from its
+// top.  The deque owns the frames that it holds.
+class work_deque
+{
+ public:
+  work_deque()
+  {
+    rings_.push_back(boost::make_unique<ring>(initial_capacity));
+    ring_.store(rings_.back().get(), std::memory_order_relaxed);
+  }
+
+  work_deque(work_deque const &) = delete;
+  work_deque &operator=(work_deque const &) = delete;
+
+  ~work_deque()
+  {
+    while (pop() != nullptr)
+    {
+    }
+  }
+
+  // Pushes a frame onto the bottom of the deque.  Only the owner may call
+  // this.
+  void push(std::unique_ptr<frame_job> job)
+  {
+    auto const bottom = bottom_.load(std::memory_order_relaxed);
+    auto const top = top_.load(std::memory_order_acquire);
+    auto *slots = ring_.load(std::memory_order_relaxed);
+
+    if (bottom - top >= slots->capacity)
+    {
+      slots = grow(slots, top, bottom);
+    }
+
+    slots->put(bottom, job.release());
+
+    // Releasing the new bottom publishes the frame to any thief that sees
+    // it.
+    bottom_.store(bottom + 1, std::memory_order_release);
+  }
+
+  // Pops the frame at the bottom of the deque, or returns null if it is
+  // empty.  Only the owner may call this.
+  std::unique_ptr<frame_job> pop()
+  {
+    auto const bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    auto *slots = ring_.load(std::memory_order_relaxed);
+
+    // The bottom is lowered before the top is read, so that a thief either
+    // sees the frame already claimed, or is seen to race for it.
+    bottom_.store(bottom, std::memory_order_seq_cst);
+    auto top = top_.load(std::memory_order_seq_cst);
+
+    if (top > bottom)
+    {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    auto *job = slots->get(bottom);
+
+    if (top == bottom)
+    {
+      // This is the last frame, for which a thief may be racing.
+      if (!top_.compare_exchange_strong(
+              top,
+              top + 1,
+              std::memory_order_seq_cst,
+              std::memory_order_relaxed))
+      {
+        job = nullptr;
+      }
+
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return std::unique_ptr<frame_job>(job);
+  }
+
+  // Steals the frame at the top of the deque, or returns null if it is
+  // empty or another worker took the frame first.  Any worker may call
+  // this.
+  std::unique_ptr<frame_job> steal()
+  {
+    auto top = top_.load(std::memory_order_seq_cst);
+    auto const bottom = bottom_.load(std::memory_order_seq_cst);
+
+    if (top >= bottom)
+    {
+      return nullptr;
+    }
+
+    auto *job = ring_.load(std::memory_order_acquire)->get(top);
+
+    if (!top_.compare_exchange_strong(
+            top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+      return nullptr;
+    }
+
+    return std::unique_ptr<frame_job>(job);
+  }
+
+  // Returns whether the deque appears to hold any frames.
+  [[nodiscard]] bool empty() const
+  {
+    return top_.load(std::memory_order_seq_cst)
+           >= bottom_.load(std::memory_order_seq_cst);
+  }
+
+ private:
+  static constexpr std::int64_t initial_capacity = 64;
+
+  // A circular array of slots, whose capacity is a power of two.
+  struct ring
+  {
+    explicit ring(std::int64_t size)
+      : capacity(size), slots(new std::atomic<frame_job *>[size])
+    {
+    }
+
+    [[nodiscard]] frame_job *get(std::int64_t index) const
+    {
+      return slots[index & (capacity - 1)].load(std::memory_order_relaxed);
+    }
+
+    void put(std::int64_t index, frame_job *job)
+    {
+      slots[index & (capacity - 1)].store(job, std::memory_order_relaxed);
+    }
+
+    std::int64_t capacity;
+    std::unique_ptr<std::atomic<frame_job *>[]> slots;
+  };
+
+  // Replaces a full ring with one of twice its capacity.  The old ring is
+  // kept until the deque is destroyed, since a thief may still be reading
+  // from it.
+  ring *grow(ring *old, std::int64_t top, std::int64_t bottom)
+  {
+    rings_.push_back(boost::make_unique<ring>(old->capacity * 2));
+    auto *bigger = rings_.back().get();
+
+    for (auto index = top; index < bottom; ++index)
+    {
+      bigger->put(index, old->get(index));
+    }
+
+    ring_.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+  std::atomic<std::int64_t> top_{0};
+  std::atomic<std::int64_t> bottom_{0};
+  std::atomic<ring *> ring_{nullptr};
+  std::vector<std::unique_ptr<ring>> rings_;
+};
+
+// ==========================================================================
+// WORKER
+// ==========================================================================
+// The frames of a single worker: those submitted for it since it last
+// looked, in its mailbox, and those that it has taken in, in its deque.
+struct worker
+{
+  std::mutex mailbox_mutex_;
+  std::vector<std::unique_ptr<frame_job>> mailbox_;
+  std::atomic<bool> mail_{false};
+  work_deque jobs_;
+};
+
+// ==========================================================================
+// LATER_DEADLINE
+// ==========================================================================
+bool later_deadline(
+    std::unique_ptr<frame_job> const &lhs,
+    std::unique_ptr<frame_job> const &rhs)
+{
+  return lhs->deadline > rhs->deadline;
+}
+
+// ==========================================================================
+// CANCEL
+// ==========================================================================
+void cancel(std::unique_ptr<frame_job> const &job)
+{
+  if (job->cancel)
+  {
+    job->cancel();
+  }
+}
+
+}  // namespace
+
+// ==========================================================================
+// FRAME_SCHEDULER::IMPLEMENTATION STRUCTURE
+// ==========================================================================
+struct frame_scheduler::impl
+{
+  // ======================================================================
+  // CONSTRUCTOR
+  // ======================================================================
+  explicit impl(unsigned int workers) : workers_(std::max(workers, 1U))
+  {
+    threads_.reserve(workers_.size());
+
+    for (std::size_t index = 0; index < workers_.size(); ++index)
+    {
+      threads_.emplace_back([this, index] { run(index); });
+    }
+  }
+
+  // ======================================================================
+  // DESTRUCTOR
+  // ======================================================================
+  ~impl()
+  {
+    {
+      auto const lock = std::unique_lock<std::mutex>(mutex_);
+      stopped_ = true;
+    }
+
+    wake_.notify_all();
+
+    for (auto &thread : threads_)
+    {
+      thread.join();
+    }
+
+    // Every frame that was never rendered is cancelled, so that whoever
+    // submitted it is not left waiting for it.
+    for (auto &owner : workers_)
+    {
+      for (auto const &job : owner.mailbox_)
+      {
+        cancel(job);
+      }
+
+      while (auto job = owner.jobs_.pop())
+      {
+        cancel(job);
+      }
+    }
+  }
+
+  impl(impl const &) = delete;
+  impl &operator=(impl const &) = delete;
+
+  // ======================================================================
+  // SUBMIT
+  // ======================================================================
+  void submit(frame_job job)
+  {
+    auto &owner = workers_[job.home % workers_.size()];
+
+    {
+      auto const lock = std::unique_lock<std::mutex>(owner.mailbox_mutex_);
+      owner.mailbox_.push_back(boost::make_unique<frame_job>(std::move(job)));
+      owner.mail_.store(true, std::memory_order_seq_cst);
+    }
+
+    notify();
+  }
+
+ private:
+  // ======================================================================
+  // RUN
+  // ======================================================================
+  void run(std::size_t index)
+  {
+    auto &self = workers_[index];
+
+    while (!stopped_)
+    {
+      // The frames in the worker's mailbox are taken in before the next
+      // frame is taken, so that a frame with an early deadline, such as
+      // one that answers a keypress, waits only for the frames that are
+      // more urgent than it, and not for the whole backlog.
+      adopt(self, collect(self));
+
+      if (auto job = take(index))
+      {
+        TEXTRAY_TRACE_SPAN("frame render");
+        job->render();
+        continue;
+      }
+
+      // The frames themselves, rather than a count of them, are checked
+      // before waiting, so that a worker waits only when there is truly
+      // nothing for it to take.
+      auto lock = std::unique_lock<std::mutex>(mutex_);
+      wake_.wait(lock, [this] { return stopped_ || has_work(); });
+    }
+  }
+
+  // ======================================================================
+  // COLLECT
+  // ======================================================================
+  // Empties a worker's mailbox.
+  static std::vector<std::unique_ptr<frame_job>> collect(worker &owner)
+  {
+    if (!owner.mail_.load(std::memory_order_seq_cst))
+    {
+      return {};
+    }
+
+    auto const lock = std::unique_lock<std::mutex>(owner.mailbox_mutex_);
+    owner.mail_.store(false, std::memory_order_seq_cst);
+    return std::exchange(owner.mailbox_, {});
+  }
+
+  // ======================================================================
+  // ADOPT
+  // ======================================================================
+  // Takes frames into the deque of the worker that calls this, which is
+  // then kept in order of deadline, with the most urgent at the bottom,
+  // where its owner pops.  Thieves therefore steal the least urgent
+  // frames, which can best afford to move.
+  void adopt(worker &self, std::vector<std::unique_ptr<frame_job>> batch)
+  {
+    if (batch.empty())
+    {
+      return;
+    }
+
+    // The frames already in the deque are popped back out, so that the
+    // deque can be put in order as a whole.
+    while (auto job = self.jobs_.pop())
+    {
+      batch.push_back(std::move(job));
+    }
+
+    std::stable_sort(batch.begin(), batch.end(), later_deadline);
+
+    for (auto &job : batch)
+    {
+      self.jobs_.push(std::move(job));
+    }
+
+    // Idle workers are woken to steal from the deque.
+    notify();
+  }
+
+  // ======================================================================
+  // TAKE
+  // ======================================================================
+  // Pops the next frame from the worker's own deque or, if that is empty,
+  // steals one from the top of another's.  Failing that, it takes in the
+  // mailbox of another, whose owner may be busy with a slow frame.
+  std::unique_ptr<frame_job> take(std::size_t index)
+  {
+    auto &self = workers_[index];
+
+    if (auto job = self.jobs_.pop())
+    {
+      return job;
+    }
+
+    for (std::size_t offset = 1; offset < workers_.size(); ++offset)
+    {
+      auto &victim = workers_[(index + offset) % workers_.size()];
+
+      if (auto job = victim.jobs_.steal())
+      {
+        return job;
+      }
+    }
+
+    for (std::size_t offset = 1; offset < workers_.size(); ++offset)
+    {
+      auto &victim = workers_[(index + offset) % workers_.size()];
+      auto batch = collect(victim);
+
+      if (!batch.empty())
+      {
+        adopt(self, std::move(batch));
+        return self.jobs_.pop();
+      }
+    }
+
+    return nullptr;
+  }
+
+  // ======================================================================
+  // HAS_WORK
+  // ======================================================================
+  // Returns whether any worker has a frame in its mailbox or its deque.
+  bool has_work() const
+  {
+    return std::any_of(
+        workers_.begin(),
+        workers_.end(),
+        [](worker const &owner)
+        {
+          return owner.mail_.load(std::memory_order_seq_cst)
+                 || !owner.jobs_.empty();
+        });
+  }
+
+  // ======================================================================
+  // NOTIFY
+  // ======================================================================
+  // Wakes the workers for new frames.  Taking the lock ensures that no
+  // worker can have found nothing to take, but not yet be waiting, when
+  // it is woken.
+  void notify()
+  {
+    {
+      auto const lock = std::unique_lock<std::mutex>(mutex_);
+    }
+
+    wake_.notify_all();
+  }
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::atomic<bool> stopped_{false};
+  std::vector<worker> workers_;
+  std::vector<std::thread> threads_;
+};
+
+// ==========================================================================
+// CONSTRUCTOR
+// ==========================================================================
+frame_scheduler::frame_scheduler(unsigned int workers)
+  : pimpl_(boost::make_unique<impl>(workers))
+{
+}
+
+// ==========================================================================
+// DESTRUCTOR
+// ==========================================================================
+frame_scheduler::~frame_scheduler() = default;
+
+// ==========================================================================
+// SUBMIT
+// ==========================================================================
+void frame_scheduler::submit(frame_job job)
+{
+  pimpl_->submit(std::move(job));
+}
+
+}  // namespace textray
@@ -0,0 +1,815 @@
+// textray_golden: renders a fixed set of camera poses, fields of view,
+// viewport sizes and colour depths headless, compares every cell of each
+// frame against a committed golden frame, and reports how long each frame
+// took to render.  With --record, the golden frames are (re)written
+// instead.  With --precision or --column-stride, the frames are cast in a
+// reduced precision or adaptively, and compared against the same golden
+// frames, within --tolerance.
+//
+// The frames are rendered by render_frame(), which is all that the camera
+// does to draw itself, rather than through the camera, which is a munin
+// component and so can only be drawn into a munin window.
+
+#include "lightmap.hpp"
+#include "render.hpp"
+#include "texture.hpp"
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace po = boost::program_options;
+
+namespace {
+
+// The floorplan of the golden frames.  This is deliberately separate from
+// the level served to clients, so that changing the level does not
+// invalidate the golden frames.
+textray::floorplan const golden_floorplan = {{
+    // clang-format off
+ { 1, 1, 2, 2, 3, 3, 4, 4 },
+ { 3, 0, 0, 0, 0, 0, 0, 4 },
+ { 3, 0, 0, 0, 5, 0, 0, 4 },
+ { 4, 2, 0, 0, 0, 0, 0, 5 },
+ { 4, 2, 0, 0, 0, 0, 0, 5 },
+ { 5, 0, 0, 0, 0, 0, 0, 6 },
+ { 5, 0, 0, 1, 0, 0, 0, 6 },
+ { 7, 0, 0, 0, 0, 0, 0, 7 },
+ { 7, 4, 4, 2, 2, 5, 5, 9 }
+    // clang-format on
+}};
+
+// ==========================================================================
+// TEXTURED_FLOORPLAN
+// ==========================================================================
+// The golden floorplan with textures on two of its kinds of tile, and on
+// the floors and ceilings of some of its open tiles.
+textray::floorplan const &textured_floorplan()
+{
+  static auto const plan = []
+  {
+    using terminalpp::true_colour;
+
+    auto const bricks =
+        std::make_shared<textray::texture const>(textray::make_texture(
+            {true_colour{0xA0, 0x3C, 0x28}, true_colour{0xC8, 0xC8, 0xB4}},
+            {"########",
+             "===#====",
+             "########",
+             "=======#",
+             "########",
+             "===#====",
+             "########",
+             "=======#"},
+            {"00000000",
+             "11101111",
+             "00000000",
+             "11111110",
+             "00000000",
+             "11101111",
+             "00000000",
+             "11111110"}));
+
+    auto const panels =
+        std::make_shared<textray::texture const>(textray::make_texture(
+            {true_colour{0x30, 0x50, 0xA0}, true_colour{0x90, 0xA8, 0xE0}},
+            {"+--+",
+             "|##|",
+             "|##|",
+             "+--+"},
+            {"1111",
+             "1001",
+             "1001",
+             "1111"}));
+
+    auto const flagstones =
+        std::make_shared<textray::texture const>(textray::make_texture(
+            {true_colour{0x50, 0x50, 0x48}, true_colour{0x78, 0x70, 0x60}},
+            {"+---+---",
+             "|###|###",
+             "+-+-+-+-",
+             "##|###|#"},
+            {"00000000",
+             "01110111",
+             "00000000",
+             "11011101"}));
+
+    auto const beams =
+        std::make_shared<textray::texture const>(textray::make_texture(
+            {true_colour{0x40, 0x28, 0x18}, true_colour{0x68, 0x48, 0x30}},
+            {"=  =",
+             "=  =",
+             "=  =",
+             "=  ="},
+            {"0110",
+             "0110",
+             "0110",
+             "0110"}));
+
+    auto textured = golden_floorplan;
+
+    for (std::size_t y = 0; y < textured.size(); ++y)
+    {
+      for (std::size_t x = 0; x < textured[y].size(); ++x)
+      {
+        auto &tile = textured[y][x];
+
+        switch (tile.fill.glyph_.character_)
+        {
+          // Only some of the open tiles are textured, so that the edges
+          // between textured and plain floors and ceilings are covered.
+          case 0:
+            if (x < 4)
+            {
+              tile.floor_surface = flagstones;
+            }
+
+            if (y < 4)
+            {
+              tile.ceiling_surface = beams;
+            }
+            break;
+
+          case 2:
+            tile.surface = bricks;
+            break;
+
+          case 4:
+            tile.surface = panels;
+            break;
+
+          default:
+            break;
+        }
+      }
+    }
+
+    return textured;
+  }();
+
+  return plan;
+}
+
+// ==========================================================================
+// STEPPED_FLOORPLAN
+// ==========================================================================
+// The golden floorplan with walls of three heights other than the standard
+// one: both of its pillars are short enough to be seen over, and one of its
+// kinds of tile towers over the rest.
+textray::floorplan const &stepped_floorplan()
+{
+  static auto const plan = []
+  {
+    auto stepped = golden_floorplan;
+
+    for (auto &row : stepped)
+    {
+      for (auto &tile : row)
+      {
+        switch (tile.fill.glyph_.character_)
+        {
+          case 1:
+            tile.height = 0.6;
+            break;
+
+          case 3:
+            tile.height = 1.6;
+            break;
+
+          case 5:
+            tile.height = 0.35;
+            break;
+
+          default:
+            break;
+        }
+      }
+    }
+
+    return stepped;
+  }();
+
+  return plan;
+}
+
+// ==========================================================================
+// GLAZED_FLOORPLAN
+// ==========================================================================
+// The golden floorplan with see-through walls of both kinds: one of its
+// kinds of tile is tinted glass, and another an iron grate.
+textray::floorplan const &glazed_floorplan()
+{
+  static auto const plan = []
+  {
+    using terminalpp::true_colour;
+
+    auto const grate =
+        std::make_shared<textray::texture const>(textray::make_texture(
+            {true_colour{0x50, 0x50, 0x58}},
+            {"#  #  #  ",
+             "#########",
+             "#  #  #  ",
+             "#  #  #  ",
+             "#########",
+             "#  #  #  "},
+            {"000000000",
+             "000000000",
+             "000000000",
+             "000000000",
+             "000000000",
+             "000000000"}));
+
+    auto glazed = golden_floorplan;
+
+    for (auto &row : glazed)
+    {
+      for (auto &tile : row)
+      {
+        switch (tile.fill.glyph_.character_)
+        {
+          case 1:
+            tile.surface = grate;
+            tile.see_through = true;
+            break;
+
+          case 5:
+            tile.see_through = true;
+            break;
+
+          default:
+            break;
+        }
+      }
+    }
+
+    return glazed;
+  }();
+
+  return plan;
+}
+
+// ==========================================================================
+// FENCED_FLOORPLAN
+// ==========================================================================
+// The golden floorplan with a broken fence of low posts across it.  Looking
+// along the fence, each ray crosses more posts than it can see walls, and
+// the standard walls beyond are seen only through the gaps between them.
+textray::floorplan const &fenced_floorplan()
+{
+  static auto const plan = []
+  {
+    static constexpr std::pair<int, int> posts[] = {
+        {5, 1}, {5, 3}, {5, 4}, {4, 6}, {4, 7}};
+
+    auto fenced = golden_floorplan;
+
+    for (auto const &[x, y] : posts)
+    {
+      auto &tile = fenced[y][x];
+      tile = textray::tile{2};
+      tile.height = 0.3;
+    }
+
+    return fenced;
+  }();
+
+  return plan;
+}
+
+// ==========================================================================
+// GOLDEN_LIGHTING
+// ==========================================================================
+// Two lights on the golden floorplan, placed so that each of its pillars
+// casts a shadow.
+textray::lightmap const &golden_lighting()
+{
+  static textray::lightmap const lighting{
+      golden_floorplan,
+      {{{2.5, 1.5}, 60, 4}, {{5.5, 6.5}, 80, 5}}};
+
+  return lighting;
+}
+
+constexpr char golden_header[] = "textray-golden 1";
+
+struct pose
+{
+  textray::vector2d position;
+  double heading_degrees;
+};
+
+pose const poses[] = {
+    {{3.0, 2.0}, 210},
+    {{4.5, 4.5}, 0},
+    {{1.5, 6.5}, 45},
+    {{6.2, 1.3}, 135},
+    {{2.1, 3.9}, 270},
+};
+
+constexpr double fovs_degrees[] = {60, 90, 150};
+
+terminalpp::extent const viewport_sizes[] = {
+    {80, 24},
+    {132, 43},
+    {40, 12},
+};
+
+struct colour_setting
+{
+  char const *name;
+  textray::colour_depth depth;
+  int bands;
+};
+
+constexpr colour_setting colour_settings[] = {
+    {"true", textray::colour_depth::true_colour, 0},
+    {"high-banded", textray::colour_depth::high_colour, 8},
+    {"low", textray::colour_depth::low_colour, 0},
+    {"grey", textray::colour_depth::greyscale, 0},
+};
+
+struct mode_setting
+{
+  char const *suffix;
+  textray::render_mode mode;
+};
+
+constexpr mode_setting mode_settings[] = {
+    {"", textray::render_mode::cells},
+    {"-half-blocks", textray::render_mode::half_blocks},
+    {"-braille", textray::render_mode::braille},
+};
+
+// How the golden floorplan is dressed: in textures, with its walls lit by
+// the golden lights, raised to different heights, made see-through, or
+// fenced with low posts.
+enum class dressing
+{
+  plain,
+  textured,
+  lit,
+  stepped,
+  glazed,
+  fenced,
+};
+
+struct dressing_setting
+{
+  char const *suffix;
+  dressing kind;
+};
+
+constexpr dressing_setting dressing_settings[] = {
+    {"", dressing::plain},
+    {"-textured", dressing::textured},
+    {"-lit", dressing::lit},
+    {"-stepped", dressing::stepped},
+    {"-glazed", dressing::glazed},
+    {"-fenced", dressing::fenced},
+};
+
+struct golden_case
+{
+  std::string name;
+  pose camera_pose;
+  double fov_degrees;
+  terminalpp::extent size;
+  colour_setting colours;
+  textray::render_mode mode;
+  dressing dressed;
+};
+
+// ==========================================================================
+// TO_RADIANS
+// ==========================================================================
+constexpr double to_radians(double angle_degrees)
+{
+  return angle_degrees * M_PI / 180;
+}
+
+// ==========================================================================
+// ALL_CASES
+// ==========================================================================
+std::vector<golden_case> all_cases()
+{
+  std::vector<golden_case> cases;
+
+  // Every pose, field of view, size and mode is rendered in true colour,
+  // while the other colour settings are rendered for the first size and
+  // mode only, to keep the number of golden frames manageable.  Dressed
+  // floorplans are rendered likewise, but for the first size only.
+  for (std::size_t pose_index = 0; pose_index < std::size(poses);
+       ++pose_index)
+  {
+    for (auto const fov : fovs_degrees)
+    {
+      for (auto const &size : viewport_sizes)
+      {
+        for (auto const &dressed : dressing_settings)
+        {
+          for (auto const &colours : colour_settings)
+          {
+            for (auto const &mode : mode_settings)
+            {
+              if ((colours.depth != textray::colour_depth::true_colour
+                   && (size != viewport_sizes[0]
+                       || mode.mode != mode_settings[0].mode))
+                  || (dressed.kind != dressing::plain
+                      && size != viewport_sizes[0]))
+              {
+                continue;
+              }
+
+              cases.push_back(
+                  {(boost::format("pose%d-fov%g-%dx%d-%s%s%s") % pose_index
+                    % fov % size.width_ % size.height_ % colours.name
+                    % mode.suffix % dressed.suffix)
+                       .str(),
+                   poses[pose_index],
+                   fov,
+                   size,
+                   colours,
+                   mode.mode,
+                   dressed.kind});
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return cases;
+}
+
+// ==========================================================================
+// FLOORPLAN_OF
+// ==========================================================================
+textray::floorplan const &floorplan_of(golden_case const &test)
+{
+  switch (test.dressed)
+  {
+    case dressing::textured:
+      return textured_floorplan();
+
+    case dressing::stepped:
+      return stepped_floorplan();
+
+    case dressing::glazed:
+      return glazed_floorplan();
+
+    case dressing::fenced:
+      return fenced_floorplan();
+
+    default:
+      return golden_floorplan;
+  }
+}
+
+// ==========================================================================
+// RENDER_CASE
+// ==========================================================================
+std::vector<terminalpp::string> render_case(
+    golden_case const &test,
+    textray::shade_table const &shades,
+    textray::render_options options)
+{
+  options.mode = test.mode;
+  options.lighting =
+      test.dressed == dressing::lit ? &golden_lighting() : nullptr;
+
+  return textray::render_frame(
+      test.size,
+      floorplan_of(test),
+      shades,
+      test.camera_pose.position,
+      to_radians(test.camera_pose.heading_degrees),
+      to_radians(test.fov_degrees),
+      options);
+}
+
+// ==========================================================================
+// DESCRIBE_CELLS
+// ==========================================================================
+// Describes each cell of a frame as a line of text, in row-major order.
+std::vector<std::string> describe_cells(
+    std::vector<terminalpp::string> const &frame)
+{
+  std::vector<std::string> cells;
+
+  for (std::size_t row = 0; row < frame.size(); ++row)
+  {
+    for (std::size_t column = 0; column < frame[row].size(); ++column)
+    {
+      std::ostringstream cell;
+      cell << column << " " << row << " " << frame[row][column];
+      cells.push_back(cell.str());
+    }
+  }
+
+  return cells;
+}
+
+// ==========================================================================
+// GOLDEN_FILENAME
+// ==========================================================================
+std::string golden_filename(
+    std::string const &directory, golden_case const &test)
+{
+  return directory + "/" + test.name + ".golden";
+}
+
+// ==========================================================================
+// WRITE_GOLDEN
+// ==========================================================================
+bool write_golden(
+    std::string const &filename, std::vector<std::string> const &cells)
+{
+  std::ofstream out(filename, std::ios::trunc);
+  out << golden_header << "\n";
+
+  for (auto const &cell : cells)
+  {
+    out << cell << "\n";
+  }
+
+  return static_cast<bool>(out);
+}
+
+// ==========================================================================
+// READ_GOLDEN
+// ==========================================================================
+bool read_golden(std::string const &filename, std::vector<std::string> &cells)
+{
+  std::ifstream in(filename);
+  std::string line;
+
+  if (!std::getline(in, line) || line != golden_header)
+  {
+    return false;
+  }
+
+  while (std::getline(in, line))
+  {
+    cells.push_back(line);
+  }
+
+  return true;
+}
+
+// ==========================================================================
+// COMPARE
+// ==========================================================================
+// Compares the cells of a frame with its golden frame, reporting up to
+// max_reported differences.  Returns the number of differences.
+std::size_t compare(
+    std::ostream &out,
+    std::vector<std::string> const &expected,
+    std::vector<std::string> const &actual,
+    std::size_t max_reported)
+{
+  std::size_t differences = 0;
+  auto const common = std::min(expected.size(), actual.size());
+
+  for (std::size_t index = 0; index < common; ++index)
+  {
+    if (expected[index] != actual[index])
+    {
+      if (differences++ < max_reported)
+      {
+        out << "    expected: " << expected[index] << "\n"
+            << "    actual:   " << actual[index] << "\n";
+      }
+    }
+  }
+
+  if (expected.size() != actual.size())
+  {
+    out << boost::format("    expected %d cells, but rendered %d\n")
+               % expected.size() % actual.size();
+    differences += std::max(expected.size(), actual.size()) - common;
+  }
+
+  if (differences > max_reported)
+  {
+    out << boost::format("    ... and %d more\n")
+               % (differences - max_reported);
+  }
+
+  return differences;
+}
+
+// ==========================================================================
+// TIME_CASE
+// ==========================================================================
+// Renders a case repeatedly, returning the fastest and median times of a
+// single frame, in microseconds.
+std::pair<double, double> time_case(
+    golden_case const &test,
+    textray::shade_table const &shades,
+    textray::render_options const &options,
+    unsigned int iterations)
+{
+  std::vector<double> times;
+
+  for (unsigned int iteration = 0; iteration < iterations; ++iteration)
+  {
+    auto const start = std::chrono::steady_clock::now();
+    auto const frame = render_case(test, shades, options);
+    auto const end = std::chrono::steady_clock::now();
+
+    times.push_back(
+        std::chrono::duration<double, std::micro>(end - start).count());
+  }
+
+  if (times.empty())
+  {
+    return {0, 0};
+  }
+
+  std::sort(times.begin(), times.end());
+  return {times.front(), times[times.size() / 2]};
+}
+
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+  std::string directory;
+  bool record = false;
+  unsigned int iterations = 0;
+  std::size_t max_reported = 0;
+  std::string filter;
+  std::string precision_name;
+  double tolerance = 0;
+  textray::render_options options;
+
+  po::options_description description("Available options");
+  description.add_options()("help,h", "show this help message")(
+      "directory,d",
+      po::value<std::string>(&directory),
+      "directory containing the golden frames")(
+      "record",
+      "write the golden frames rather than comparing against them")(
+      "iterations,i",
+      po::value<unsigned int>(&iterations)->default_value(50),
+      "number of times each case is rendered when timing it")(
+      "max-diffs,m",
+      po::value<std::size_t>(&max_reported)->default_value(10),
+      "maximum number of differing cells reported per case")(
+      "filter,f",
+      po::value<std::string>(&filter),
+      "only run the cases whose names contain this text")(
+      "precision,p",
+      po::value<std::string>(&precision_name)->default_value("double"),
+      "precision in which rays are cast: double, float or fixed")(
+      "column-stride,s",
+      po::value<int>(&options.column_stride)->default_value(1),
+      "interval at which columns are cast before those between them are "
+      "refined")(
+      "tolerance,t",
+      po::value<double>(&tolerance)->default_value(0),
+      "percentage of each frame's cells that may differ from its golden "
+      "frame");
+
+  po::positional_options_description pos_description;
+  pos_description.add("directory", -1);
+
+  try
+  {
+    po::variables_map vm;
+    po::store(
+        po::command_line_parser(argc, argv)
+            .options(description)
+            .positional(pos_description)
+            .run(),
+        vm);
+
+    po::notify(vm);
+
+    if (vm.count("help") != 0)
+    {
+      throw po::error("");
+    }
+    else if (vm.count("directory") == 0)
+    {
+      throw po::error("The directory of golden frames must be specified");
+    }
+
+    if (auto const parsed = textray::render_precision_from_name(precision_name);
+        parsed)
+    {
+      options.precision = *parsed;
+    }
+    else
+    {
+      throw po::error("Unknown precision: " + precision_name);
+    }
+
+    record = vm.count("record") != 0;
+
+    if (record
+        && (options.precision != textray::render_precision::double_precision
+            || options.column_stride > 1))
+    {
+      throw po::error(
+          "Golden frames must be recorded in double precision, casting every "
+          "column");
+    }
+  }
+  catch (po::error &err)
+  {
+    if (strlen(err.what()) == 0)
+    {
+      std::cout << boost::format("USAGE: %s <directory>|<options>\n")
+                       % argv[0]
+                << description << std::endl;
+
+      return EXIT_SUCCESS;
+    }
+
+    std::cerr << boost::format(
+                     "ERROR: %s\n\nUSAGE: %s <directory>|<options>\n")
+                     % err.what() % argv[0]
+              << description << std::endl;
+
+    return EXIT_FAILURE;
+  }
+
+  std::size_t failures = 0;
+  std::size_t cases_run = 0;
+
+  for (auto const &test : all_cases())
+  {
+    if (test.name.find(filter) == std::string::npos)
+    {
+      continue;
+    }
+
+    ++cases_run;
+
+    // The shade table and the floorplan's summary are made once, as the
+    // camera makes them, so that they are not timed with each frame.
+    auto const shades = textray::make_shade_table(
+        floorplan_of(test), test.colours.depth, test.colours.bands);
+    auto const summary = textray::summarise_floorplan(floorplan_of(test));
+    auto summarised = options;
+    summarised.summary = &summary;
+
+    auto const cells =
+        describe_cells(render_case(test, shades, summarised));
+    auto const filename = golden_filename(directory, test);
+    auto const [fastest, median] =
+        time_case(test, shades, summarised, iterations);
+
+    std::string result;
+    std::ostringstream report;
+    std::vector<std::string> expected;
+
+    if (record)
+    {
+      result = write_golden(filename, cells) ? "RECORDED" : "WRITE FAILED";
+    }
+    else if (!read_golden(filename, expected))
+    {
+      result = "MISSING";
+    }
+    else if (auto const differences =
+                 compare(report, expected, cells, max_reported);
+             differences != 0)
+    {
+      auto const percentage = 100.0 * differences / std::max<std::size_t>(
+                                                        expected.size(), 1);
+
+      result = (boost::format("%s (%d cells differ)")
+                % (percentage <= tolerance ? "OK" : "FAILED") % differences)
+                   .str();
+    }
+    else
+    {
+      result = "OK";
+    }
+
+    if (result.compare(0, 2, "OK") != 0 && result != "RECORDED")
+    {
+      ++failures;
+    }
+
+    std::cout << boost::format("%-40s %8.1fus min %8.1fus median  %s\n")
+                     % test.name % fastest % median % result
+              << report.str();
+  }
+
+  std::cout << boost::format("%d cases, %d failed\n") % cases_run % failures;
+
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,138 @@
+#include "histogram.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace textray {
+
+// ==========================================================================
+// RECORD
+// ==========================================================================
+void histogram::record(std::uint64_t value)
+{
+  buckets_[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+}
+
+// ==========================================================================
+// MERGE
+// ==========================================================================
+void histogram::merge(histogram const &other)
+{
+  for (std::size_t bucket = 0; bucket < bucket_count; ++bucket)
+  {
+    buckets_[bucket].fetch_add(
+        other.buckets_[bucket].load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+  }
+
+  count_.fetch_add(
+      other.count_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  sum_.fetch_add(
+      other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+// ==========================================================================
+// COUNT
+// ==========================================================================
+std::uint64_t histogram::count() const
+{
+  return count_.load(std::memory_order_relaxed);
+}
+
+// ==========================================================================
+// SUM
+// ==========================================================================
+std::uint64_t histogram::sum() const
+{
+  return sum_.load(std::memory_order_relaxed);
+}
+
+// ==========================================================================
+// QUANTILE
+// ==========================================================================
+std::uint64_t histogram::quantile(double q) const
+{
+  // The total is taken from the buckets themselves rather than count_,
+  // since samples may be recorded while the buckets are being read.
+  std::uint64_t total = 0;
+
+  for (auto const &bucket : buckets_)
+  {
+    total += bucket.load(std::memory_order_relaxed);
+  }
+
+  if (total == 0)
+  {
+    return 0;
+  }
+
+  auto const rank = std::max(
+      std::uint64_t{1},
+      static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(total))));
+  std::uint64_t seen = 0;
+
+  for (std::size_t bucket = 0; bucket < bucket_count; ++bucket)
+  {
+    seen += buckets_[bucket].load(std::memory_order_relaxed);
+
+    if (seen >= rank)
+    {
+      return value_of(bucket);
+    }
+  }
+
+  return value_of(bucket_count - 1);
+}
+
+// ==========================================================================
+// BUCKET_OF
+// ==========================================================================
+std::size_t histogram::bucket_of(std::uint64_t value)
+{
+  if (value < sub_buckets)
+  {
+    return static_cast<std::size_t>(value);
+  }
+
+  // Values in [2^n, 2^(n+1)) are divided into sub_buckets buckets, each
+  // 2^(n - sub_bucket_bits) wide.
+  std::size_t magnitude = sub_bucket_bits;
+
+  while (magnitude + 1 < value_bits && (value >> (magnitude + 1)) != 0)
+  {
+    ++magnitude;
+  }
+
+  auto const shift = magnitude - sub_bucket_bits;
+
+  if ((value >> shift) >= 2 * sub_buckets)
+  {
+    return bucket_count - 1;
+  }
+
+  auto const sub_bucket =
+      static_cast<std::size_t>(value >> shift) - sub_buckets;
+
+  return ((shift + 1) * sub_buckets) + sub_bucket;
+}
+
+// ==========================================================================
+// VALUE_OF
+// ==========================================================================
+std::uint64_t histogram::value_of(std::size_t bucket)
+{
+  if (bucket < sub_buckets)
+  {
+    return bucket;
+  }
+
+  // Report the middle of the bucket's range.
+  auto const shift = (bucket / sub_buckets) - 1;
+  auto const sub_bucket = bucket % sub_buckets;
+  auto const lower_bound = std::uint64_t{sub_buckets + sub_bucket} << shift;
+
+  return lower_bound + ((std::uint64_t{1} << shift) / 2);
+}
+
+}  // namespace textray
@@ -0,0 +1,378 @@
+#include "lightmap.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace textray {
+
+namespace {
+
+constexpr std::size_t faces_per_tile = 4;
+
+constexpr std::array<wall_face, faces_per_tile> all_faces = {
+    wall_face::west, wall_face::east, wall_face::north, wall_face::south};
+
+// Points at which a face is lit are moved this far in front of it, so that
+// they lie in the tile that the face looks onto.
+constexpr double face_offset = 1e-6;
+
+// ==========================================================================
+// IS_OPEN
+// ==========================================================================
+// Returns whether the tile at the given position is open, rather than a
+// wall.  Everything beyond the edges of the floorplan is a wall.
+bool is_open(floorplan const &plan, int x, int y)
+{
+  return y >= 0 && x >= 0 && static_cast<std::size_t>(y) < plan.size()
+         && static_cast<std::size_t>(x) < plan[y].size()
+         && plan[y][x].fill.glyph_.character_ == 0;
+}
+
+// ==========================================================================
+// IS_CLEAR
+// ==========================================================================
+// Returns whether light passes through the tile at the given position:
+// whether it is open, or a see-through wall.
+bool is_clear(floorplan const &plan, int x, int y)
+{
+  return is_open(plan, x, y)
+         || (y >= 0 && x >= 0 && static_cast<std::size_t>(y) < plan.size()
+             && static_cast<std::size_t>(x) < plan[y].size()
+             && plan[y][x].see_through);
+}
+
+// ==========================================================================
+// WIDEST_ROW
+// ==========================================================================
+// Returns the length of the floorplan's longest row, so that the lightmap
+// covers every tile even if its rows differ in length.
+std::size_t widest_row(floorplan const &plan)
+{
+  std::size_t widest = 0;
+
+  for (auto const &row : plan)
+  {
+    widest = std::max(widest, row.size());
+  }
+
+  return widest;
+}
+
+// ==========================================================================
+// UNOBSTRUCTED
+// ==========================================================================
+// Returns whether a straight line between two points crosses no opaque
+// wall, stepping through the tiles that it crosses as rays are cast.
+bool unobstructed(
+    floorplan const &plan, vector2d const &from, vector2d const &to)
+{
+  constexpr auto never = std::numeric_limits<double>::infinity();
+
+  auto map_x = static_cast<int>(std::floor(from.x));
+  auto map_y = static_cast<int>(std::floor(from.y));
+  auto const end_x = static_cast<int>(std::floor(to.x));
+  auto const end_y = static_cast<int>(std::floor(to.y));
+
+  if (!is_clear(plan, map_x, map_y))
+  {
+    return false;
+  }
+
+  // The distances are measured as fractions of the line, so that the line
+  // ends at 1.
+  auto const line = to - from;
+  auto const step_x = line.x < 0 ? -1 : 1;
+  auto const step_y = line.y < 0 ? -1 : 1;
+  auto const delta_dist_x = line.x == 0 ? never : std::abs(1 / line.x);
+  auto const delta_dist_y = line.y == 0 ? never : std::abs(1 / line.y);
+  auto side_dist_x =
+      line.x < 0 ? (from.x - map_x) * delta_dist_x
+                 : (map_x + 1 - from.x) * delta_dist_x;
+  auto side_dist_y =
+      line.y < 0 ? (from.y - map_y) * delta_dist_y
+                 : (map_y + 1 - from.y) * delta_dist_y;
+
+  while (map_x != end_x || map_y != end_y)
+  {
+    if (side_dist_x < side_dist_y)
+    {
+      if (side_dist_x > 1)
+      {
+        break;
+      }
+
+      side_dist_x += delta_dist_x;
+      map_x += step_x;
+    }
+    else
+    {
+      if (side_dist_y > 1)
+      {
+        break;
+      }
+
+      side_dist_y += delta_dist_y;
+      map_y += step_y;
+    }
+
+    if (!is_clear(plan, map_x, map_y))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// ==========================================================================
+// FACE_POINT
+// ==========================================================================
+// Returns the point at the given position across a face of the tile at
+// the given position, measured as rays measure it: from the left of the
+// face to its right, as seen from in front of it.
+vector2d face_point(int x, int y, wall_face face, double u)
+{
+  switch (face)
+  {
+    case wall_face::west:
+      return {static_cast<double>(x), y + 1 - u};
+
+    case wall_face::east:
+      return {x + 1.0, y + u};
+
+    case wall_face::north:
+      return {x + u, static_cast<double>(y)};
+
+    default:
+      return {x + 1 - u, y + 1.0};
+  }
+}
+
+// ==========================================================================
+// FACE_NORMAL
+// ==========================================================================
+vector2d face_normal(wall_face face)
+{
+  switch (face)
+  {
+    case wall_face::west:
+      return {-1, 0};
+
+    case wall_face::east:
+      return {1, 0};
+
+    case wall_face::north:
+      return {0, -1};
+
+    default:
+      return {0, 1};
+  }
+}
+
+// ==========================================================================
+// BAKE_LUXEL
+// ==========================================================================
+// Returns the percentage of darkness that the lights remove from a point
+// on a face.  Each light falls off linearly with distance to nothing at
+// its reach, and with the cosine of the angle at which it meets the face.
+std::uint8_t bake_luxel(
+    floorplan const &plan,
+    std::vector<light> const &lights,
+    vector2d const &point,
+    vector2d const &normal)
+{
+  auto const in_front = point + normal * face_offset;
+  double total = 0;
+
+  for (auto const &source : lights)
+  {
+    auto const to_light = source.position - point;
+    auto const distance = to_light.length();
+
+    if (distance >= source.reach)
+    {
+      continue;
+    }
+
+    auto const facing = distance > 0 ? dot(to_light, normal) / distance : 1.0;
+
+    if (facing <= 0 || !unobstructed(plan, in_front, source.position))
+    {
+      continue;
+    }
+
+    total += source.brightness * (1 - distance / source.reach) * facing;
+  }
+
+  return static_cast<std::uint8_t>(
+      std::lround(std::clamp(total, 0.0, 100.0)));
+}
+
+}  // namespace
+
+// ==========================================================================
+// CONSTRUCTOR
+// ==========================================================================
+lightmap::lightmap(floorplan const &plan, std::vector<light> lights)
+  : width_(widest_row(plan)),
+    height_(plan.size()),
+    lights_(std::move(lights)),
+    luxels_(width_ * height_ * faces_per_tile * luxels_per_face)
+{
+  for (std::size_t y = 0; y < height_; ++y)
+  {
+    for (std::size_t x = 0; x < width_; ++x)
+    {
+      bake_tile(plan, x, y);
+    }
+  }
+}
+
+// ==========================================================================
+// LIGHTS
+// ==========================================================================
+std::vector<light> const &lightmap::lights() const
+{
+  return lights_;
+}
+
+// ==========================================================================
+// SET_LIGHTS
+// ==========================================================================
+void lightmap::set_lights(floorplan const &plan, std::vector<light> lights)
+{
+  auto const contains = [](std::vector<light> const &set, light const &l)
+  { return std::find(set.begin(), set.end(), l) != set.end(); };
+
+  auto old_lights = std::exchange(lights_, std::move(lights));
+
+  for (auto const &old_light : old_lights)
+  {
+    if (!contains(lights_, old_light))
+    {
+      bake_faces_within(plan, old_light.position, old_light.reach);
+    }
+  }
+
+  for (auto const &new_light : lights_)
+  {
+    if (!contains(old_lights, new_light))
+    {
+      bake_faces_within(plan, new_light.position, new_light.reach);
+    }
+  }
+}
+
+// ==========================================================================
+// TILE_CHANGED
+// ==========================================================================
+void lightmap::tile_changed(
+    floorplan const &plan, std::size_t x, std::size_t y)
+{
+  // A tile may cast a shadow on any face that a light reaching it also
+  // reaches, and its neighbours' faces towards it appear or disappear.
+  auto const centre = vector2d{x + 0.5, y + 0.5};
+  auto const half_diagonal = std::sqrt(0.5);
+
+  for (auto const &source : lights_)
+  {
+    if ((source.position - centre).length() < source.reach + half_diagonal)
+    {
+      bake_faces_within(plan, source.position, source.reach);
+    }
+  }
+
+  bake_faces_within(plan, centre, 1);
+}
+
+// ==========================================================================
+// LUXEL
+// ==========================================================================
+std::uint8_t lightmap::luxel(
+    std::size_t x, std::size_t y, wall_face face, double u) const
+{
+  if (x >= width_ || y >= height_)
+  {
+    return 0;
+  }
+
+  auto const index = std::clamp(
+      static_cast<int>(u * luxels_per_face),
+      0,
+      static_cast<int>(luxels_per_face) - 1);
+
+  return luxels_
+      [((((y * width_) + x) * faces_per_tile) + static_cast<std::size_t>(face))
+           * luxels_per_face
+       + index];
+}
+
+// ==========================================================================
+// BAKE_FACES_WITHIN
+// ==========================================================================
+// Rebakes every tile that lies at least partly within the square that
+// bounds a circle about the given centre.
+void lightmap::bake_faces_within(
+    floorplan const &plan, vector2d const &centre, double reach)
+{
+  if (width_ == 0 || height_ == 0)
+  {
+    return;
+  }
+
+  auto const tile_of = [](double coordinate, std::size_t size)
+  {
+    return std::clamp(
+        static_cast<int>(std::floor(coordinate)),
+        0,
+        static_cast<int>(size) - 1);
+  };
+
+  auto const last_x = tile_of(centre.x + reach, width_);
+  auto const last_y = tile_of(centre.y + reach, height_);
+
+  for (auto y = tile_of(centre.y - reach, height_); y <= last_y; ++y)
+  {
+    for (auto x = tile_of(centre.x - reach, width_); x <= last_x; ++x)
+    {
+      bake_tile(plan, x, y);
+    }
+  }
+}
+
+// ==========================================================================
+// BAKE_TILE
+// ==========================================================================
+void lightmap::bake_tile(floorplan const &plan, std::size_t x, std::size_t y)
+{
+  auto const map_x = static_cast<int>(x);
+  auto const map_y = static_cast<int>(y);
+  auto *luxels =
+      &luxels_[((y * width_) + x) * faces_per_tile * luxels_per_face];
+
+  for (auto const face : all_faces)
+  {
+    auto const normal = face_normal(face);
+
+    // Only the faces of walls that look onto an open tile, or through a
+    // see-through wall, can be seen, and so only they are lit.
+    auto const visible = !is_open(plan, map_x, map_y)
+                         && is_clear(
+                             plan,
+                             map_x + static_cast<int>(normal.x),
+                             map_y + static_cast<int>(normal.y));
+
+    for (std::size_t index = 0; index < luxels_per_face; ++index, ++luxels)
+    {
+      auto const u = (index + 0.5) / luxels_per_face;
+
+      *luxels = visible ? bake_luxel(
+                    plan, lights_, face_point(map_x, map_y, face, u), normal)
+                        : 0;
+    }
+  }
+}
+
+}  // namespace textray
@@ -0,0 +1,763 @@
+// textray_loadgen: opens many concurrent Telnet sessions to a textray
+// server, negotiates a window size and terminal type for each, and sends
+// movement keys at a fixed rate, measuring how the server responds.
+
+#include "histogram.hpp"
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace po = boost::program_options;
+namespace asio = boost::asio;
+using asio::ip::tcp;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+// Telnet commands and options (RFC 854, 1073, 1091).
+constexpr unsigned char iac = 255;
+constexpr unsigned char dont = 254;
+constexpr unsigned char do_ = 253;
+constexpr unsigned char wont = 252;
+constexpr unsigned char will = 251;
+constexpr unsigned char sb = 250;
+constexpr unsigned char se = 240;
+
+constexpr unsigned char echo_option = 1;
+constexpr unsigned char suppress_ga_option = 3;
+constexpr unsigned char terminal_type_option = 24;
+constexpr unsigned char naws_option = 31;
+
+constexpr unsigned char terminal_type_is = 0;
+constexpr unsigned char terminal_type_send = 1;
+
+struct window_size
+{
+  std::uint16_t width;
+  std::uint16_t height;
+};
+
+struct loadgen_settings
+{
+  std::string host;
+  std::string port;
+  unsigned int clients;
+  std::vector<window_size> window_sizes;
+  std::string terminal_type;
+  double key_rate;
+  std::string script;
+  std::chrono::milliseconds frame_gap;
+  std::chrono::seconds duration;
+};
+
+// ==========================================================================
+// TOTALS
+// ==========================================================================
+// Totals across every session.  These are updated from any thread.
+struct totals
+{
+  std::atomic<std::uint64_t> connected{0};
+  std::atomic<std::uint64_t> failed{0};
+  std::atomic<std::uint64_t> disconnected{0};
+  std::atomic<std::uint64_t> keys_sent{0};
+  std::atomic<std::uint64_t> frames{0};
+  std::atomic<std::uint64_t> bytes_received{0};
+
+  // The time from sending a key to receiving the first byte of the
+  // server's response, in microseconds.
+  textray::histogram latency_us;
+};
+
+// ==========================================================================
+// SESSION
+// ==========================================================================
+// A single simulated player.  All of a session's handlers run on its own
+// strand.
+class session : public std::enable_shared_from_this<session>
+{
+ public:
+  session(
+      asio::io_context &io_context,
+      loadgen_settings const &config,
+      window_size size,
+      std::uint32_t seed,
+      totals &results)
+    : config_(config),
+      size_(size),
+      random_(seed),
+      results_(results),
+      strand_(io_context),
+      socket_(io_context),
+      resolver_(io_context),
+      key_timer_(io_context)
+  {
+  }
+
+  // ======================================================================
+  // START
+  // ======================================================================
+  void start()
+  {
+    resolver_.async_resolve(
+        config_.host,
+        config_.port,
+        asio::bind_executor(
+            strand_,
+            [self = shared_from_this()](
+                boost::system::error_code const &ec,
+                tcp::resolver::results_type const &endpoints)
+            {
+              if (ec)
+              {
+                ++self->results_.failed;
+                return;
+              }
+
+              self->connect(endpoints);
+            }));
+  }
+
+  // ======================================================================
+  // STOP
+  // ======================================================================
+  void stop()
+  {
+    asio::post(
+        strand_,
+        [self = shared_from_this()]
+        {
+          self->stopped_ = true;
+          self->key_timer_.cancel();
+
+          boost::system::error_code ec;
+          self->socket_.shutdown(tcp::socket::shutdown_both, ec);
+          self->socket_.close(ec);
+        });
+  }
+
+ private:
+  // ======================================================================
+  // CONNECT
+  // ======================================================================
+  void connect(tcp::resolver::results_type const &endpoints)
+  {
+    asio::async_connect(
+        socket_,
+        endpoints,
+        asio::bind_executor(
+            strand_,
+            [self = shared_from_this()](
+                boost::system::error_code const &ec, tcp::endpoint const &)
+            {
+              if (ec)
+              {
+                ++self->results_.failed;
+                return;
+              }
+
+              ++self->results_.connected;
+              self->socket_.set_option(tcp::no_delay(true));
+              self->schedule_read();
+              self->schedule_key();
+            }));
+  }
+
+  // ======================================================================
+  // SCHEDULE_READ
+  // ======================================================================
+  void schedule_read()
+  {
+    socket_.async_read_some(
+        asio::buffer(read_buffer_),
+        asio::bind_executor(
+            strand_,
+            [self = shared_from_this()](
+                boost::system::error_code const &ec, std::size_t size)
+            {
+              if (ec)
+              {
+                if (!self->stopped_)
+                {
+                  ++self->results_.disconnected;
+                  self->stopped_ = true;
+                  self->key_timer_.cancel();
+                }
+
+                return;
+              }
+
+              self->results_.bytes_received += size;
+              self->receive(size);
+              self->schedule_read();
+            }));
+  }
+
+  // ======================================================================
+  // RECEIVE
+  // ======================================================================
+  void receive(std::size_t size)
+  {
+    auto const now = clock_type::now();
+    bool received_data = false;
+
+    for (std::size_t index = 0; index < size; ++index)
+    {
+      received_data |= parse(read_buffer_[index]);
+    }
+
+    if (!received_data)
+    {
+      return;
+    }
+
+    // The server does not delimit its frames, so a frame is taken to be
+    // a burst of output that follows a gap of at least frame_gap.
+    if (now - last_data_ >= config_.frame_gap)
+    {
+      ++results_.frames;
+    }
+
+    last_data_ = now;
+
+    if (key_outstanding_)
+    {
+      results_.latency_us.record(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              now - key_sent_)
+              .count());
+      key_outstanding_ = false;
+    }
+  }
+
+  // ======================================================================
+  // PARSE
+  // ======================================================================
+  // Parses a single byte of the Telnet stream, answering any negotiation
+  // it completes.  Returns true if the byte was application data.
+  bool parse(unsigned char byte)
+  {
+    switch (state_)
+    {
+      case parse_state::data:
+        if (byte == iac)
+        {
+          state_ = parse_state::iac;
+          return false;
+        }
+
+        return true;
+
+      case parse_state::iac:
+        if (byte == will || byte == wont || byte == do_ || byte == dont)
+        {
+          command_ = byte;
+          state_ = parse_state::negotiation;
+        }
+        else if (byte == sb)
+        {
+          subnegotiation_.clear();
+          state_ = parse_state::subnegotiation;
+        }
+        else
+        {
+          state_ = parse_state::data;
+          return byte == iac;
+        }
+
+        return false;
+
+      case parse_state::negotiation:
+        negotiate(command_, byte);
+        state_ = parse_state::data;
+        return false;
+
+      case parse_state::subnegotiation:
+        if (byte == iac)
+        {
+          state_ = parse_state::subnegotiation_iac;
+        }
+        else
+        {
+          subnegotiation_.push_back(static_cast<char>(byte));
+        }
+
+        return false;
+
+      case parse_state::subnegotiation_iac:
+        if (byte == se)
+        {
+          subnegotiate();
+          state_ = parse_state::data;
+        }
+        else
+        {
+          subnegotiation_.push_back(static_cast<char>(byte));
+          state_ = parse_state::subnegotiation;
+        }
+
+        return false;
+    }
+
+    return false;
+  }
+
+  // ======================================================================
+  // NEGOTIATE
+  // ======================================================================
+  void negotiate(unsigned char command, unsigned char option)
+  {
+    // Each option is answered only once, which avoids negotiation loops.
+    auto &answered = command == will || command == wont
+                         ? answered_will_[option]
+                         : answered_do_[option];
+
+    if (answered || command == wont || command == dont)
+    {
+      return;
+    }
+
+    answered = true;
+
+    if (command == will)
+    {
+      // Compression is refused so that the server's output can be parsed
+      // as it arrives.
+      auto const accepted =
+          option == echo_option || option == suppress_ga_option;
+      send({char(iac), char(accepted ? do_ : dont), char(option)});
+    }
+    else if (option == naws_option)
+    {
+      send({char(iac), char(will), char(naws_option)});
+      send_window_size();
+    }
+    else if (option == terminal_type_option)
+    {
+      send({char(iac), char(will), char(terminal_type_option)});
+    }
+    else
+    {
+      send({char(iac), char(wont), char(option)});
+    }
+  }
+
+  // ======================================================================
+  // SUBNEGOTIATE
+  // ======================================================================
+  void subnegotiate()
+  {
+    if (subnegotiation_.size() >= 2
+        && static_cast<unsigned char>(subnegotiation_[0])
+               == terminal_type_option
+        && static_cast<unsigned char>(subnegotiation_[1])
+               == terminal_type_send)
+    {
+      send(
+          std::string{char(iac), char(sb), char(terminal_type_option),
+                      char(terminal_type_is)}
+          + config_.terminal_type + std::string{char(iac), char(se)});
+    }
+  }
+
+  // ======================================================================
+  // SEND_WINDOW_SIZE
+  // ======================================================================
+  void send_window_size()
+  {
+    std::string message{char(iac), char(sb), char(naws_option)};
+
+    for (auto const value : {size_.width, size_.height})
+    {
+      for (auto const byte : {value >> 8, value & 0xFF})
+      {
+        message.push_back(char(byte));
+
+        // A data byte that happens to be IAC must be doubled.
+        if (byte == iac)
+        {
+          message.push_back(char(iac));
+        }
+      }
+    }
+
+    message += std::string{char(iac), char(se)};
+    send(std::move(message));
+  }
+
+  // ======================================================================
+  // SCHEDULE_KEY
+  // ======================================================================
+  void schedule_key()
+  {
+    if (stopped_ || config_.key_rate <= 0)
+    {
+      return;
+    }
+
+    auto const interval = std::chrono::duration_cast<clock_type::duration>(
+        std::chrono::duration<double>(1.0 / config_.key_rate));
+
+    // The first key is sent at a random point within the first interval
+    // so that sessions do not send their keys in lockstep.
+    if (next_key_ == clock_type::time_point{})
+    {
+      next_key_ = clock_type::now()
+                  + std::uniform_int_distribution<clock_type::rep>(
+                        0, interval.count())(random_)
+                        * clock_type::duration{1};
+    }
+    else
+    {
+      next_key_ += interval;
+    }
+
+    key_timer_.expires_at(next_key_);
+    key_timer_.async_wait(asio::bind_executor(
+        strand_,
+        [self = shared_from_this()](boost::system::error_code const &ec)
+        {
+          if (!ec && !self->stopped_)
+          {
+            self->send_key();
+            self->schedule_key();
+          }
+        }));
+  }
+
+  // ======================================================================
+  // SEND_KEY
+  // ======================================================================
+  void send_key()
+  {
+    static constexpr char random_keys[] = "wasdqe";
+
+    auto const key =
+        config_.script.empty()
+            ? random_keys[std::uniform_int_distribution<std::size_t>(
+                  0, std::strlen(random_keys) - 1)(random_)]
+            : config_.script[script_position_++ % config_.script.size()];
+
+    // Latency is measured only for a key that was sent while no other
+    // key awaited a response, so that each response is attributed to
+    // exactly one key.
+    if (!key_outstanding_)
+    {
+      key_outstanding_ = true;
+      key_sent_ = clock_type::now();
+    }
+
+    ++results_.keys_sent;
+    send(std::string(1, key));
+  }
+
+  // ======================================================================
+  // SEND
+  // ======================================================================
+  void send(std::string message)
+  {
+    outbox_.push_back(std::move(message));
+
+    if (outbox_.size() == 1)
+    {
+      write_next();
+    }
+  }
+
+  // ======================================================================
+  // WRITE_NEXT
+  // ======================================================================
+  void write_next()
+  {
+    asio::async_write(
+        socket_,
+        asio::buffer(outbox_.front()),
+        asio::bind_executor(
+            strand_,
+            [self = shared_from_this()](
+                boost::system::error_code const &ec, std::size_t)
+            {
+              self->outbox_.pop_front();
+
+              if (!ec && !self->outbox_.empty())
+              {
+                self->write_next();
+              }
+            }));
+  }
+
+  enum class parse_state
+  {
+    data,
+    iac,
+    negotiation,
+    subnegotiation,
+    subnegotiation_iac,
+  };
+
+  loadgen_settings const &config_;
+  window_size size_;
+  std::mt19937 random_;
+  totals &results_;
+
+  asio::io_context::strand strand_;
+  tcp::socket socket_;
+  tcp::resolver resolver_;
+  asio::steady_timer key_timer_;
+  bool stopped_{false};
+
+  std::array<unsigned char, 4096> read_buffer_{};
+  parse_state state_{parse_state::data};
+  unsigned char command_{0};
+  std::string subnegotiation_;
+  std::array<bool, 256> answered_will_{};
+  std::array<bool, 256> answered_do_{};
+
+  std::deque<std::string> outbox_;
+
+  clock_type::time_point next_key_;
+  std::size_t script_position_{0};
+  bool key_outstanding_{false};
+  clock_type::time_point key_sent_;
+  clock_type::time_point last_data_;
+};
+
+// ==========================================================================
+// PARSE_WINDOW_SIZES
+// ==========================================================================
+std::vector<window_size> parse_window_sizes(std::string const &text)
+{
+  std::vector<window_size> sizes;
+  std::size_t start = 0;
+
+  while (start <= text.size())
+  {
+    auto const end = std::min(text.find(',', start), text.size());
+    auto const item = text.substr(start, end - start);
+
+    unsigned int width = 0;
+    unsigned int height = 0;
+    char separator = 0;
+
+    if (std::sscanf(item.c_str(), "%u%c%u", &width, &separator, &height) != 3
+        || separator != 'x' || width == 0 || height == 0 || width > 0xFFFF
+        || height > 0xFFFF)
+    {
+      throw po::error("Invalid window size: " + item);
+    }
+
+    sizes.push_back(
+        {static_cast<std::uint16_t>(width),
+         static_cast<std::uint16_t>(height)});
+    start = end + 1;
+  }
+
+  return sizes;
+}
+
+// ==========================================================================
+// REPORT
+// ==========================================================================
+void report(
+    std::ostream &out,
+    totals const &results,
+    unsigned int clients,
+    std::chrono::duration<double> elapsed)
+{
+  auto const seconds = std::max(elapsed.count(), 1e-9);
+  auto const connected = std::max<std::uint64_t>(results.connected, 1);
+
+  out << boost::format(
+             "clients: %d requested, %d connected, %d failed, %d "
+             "disconnected\n")
+             % clients % results.connected % results.failed
+             % results.disconnected;
+  out << boost::format("elapsed: %.1fs\n") % seconds;
+  out << boost::format("keys sent: %d (%.1f/s)\n") % results.keys_sent
+             % (results.keys_sent / seconds);
+  out << boost::format(
+             "frames: %d (%.1f/s, %.2f/s per client)\n")
+             % results.frames % (results.frames / seconds)
+             % (results.frames / seconds / connected);
+  out << boost::format(
+             "bytes received: %d (%.1f KiB/s, %.1f KiB per client)\n")
+             % results.bytes_received
+             % (results.bytes_received / seconds / 1024)
+             % (results.bytes_received / 1024.0 / connected);
+
+  out << boost::format("keypress-to-first-byte latency (%d samples):")
+             % results.latency_us.count();
+
+  for (auto const q : {0.5, 0.9, 0.99, 0.999})
+  {
+    out << boost::format(" p%g=%.2fms") % (q * 100)
+               % (results.latency_us.quantile(q) / 1000.0);
+  }
+
+  out << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+  loadgen_settings config;
+  std::string window_sizes;
+  unsigned int threads = 1;
+  unsigned int frame_gap_ms = 0;
+  unsigned int duration_s = 0;
+  std::uint32_t seed = 0;
+
+  po::options_description description("Available options");
+  description.add_options()("help,h", "show this help message")(
+      "host",
+      po::value<std::string>(&config.host)->default_value("127.0.0.1"),
+      "host on which textray is running")(
+      "port,p",
+      po::value<std::string>(&config.port)->default_value("4000"),
+      "port on which textray is listening")(
+      "clients,c",
+      po::value<unsigned int>(&config.clients)->default_value(100),
+      "number of concurrent sessions")(
+      "threads,t",
+      po::value<unsigned int>(&threads)->default_value(1),
+      "number of threads of execution")(
+      "window-sizes,w",
+      po::value<std::string>(&window_sizes)->default_value("80x24"),
+      "comma-separated window sizes (WxH), assigned to sessions in turn")(
+      "terminal-type,T",
+      po::value<std::string>(&config.terminal_type)
+          ->default_value("xterm-256color"),
+      "terminal type reported by each session")(
+      "rate,r",
+      po::value<double>(&config.key_rate)->default_value(10),
+      "keys sent per second by each session")(
+      "script,s",
+      po::value<std::string>(&config.script),
+      "keys sent by each session in a repeating sequence (default: random "
+      "movement keys)")(
+      "frame-gap,g",
+      po::value<unsigned int>(&frame_gap_ms)->default_value(5),
+      "minimum silence in milliseconds that separates two frames")(
+      "duration,d",
+      po::value<unsigned int>(&duration_s)->default_value(30),
+      "length of the run in seconds")(
+      "seed",
+      po::value<std::uint32_t>(&seed)->default_value(0),
+      "seed for the random choice of keys and timings");
+
+  try
+  {
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, description), vm);
+    po::notify(vm);
+
+    if (vm.count("help") != 0)
+    {
+      std::cout << boost::format("USAGE: %s <options>\n") % argv[0]
+                << description << std::endl;
+      return EXIT_SUCCESS;
+    }
+
+    config.window_sizes = parse_window_sizes(window_sizes);
+    config.frame_gap = std::chrono::milliseconds{frame_gap_ms};
+    config.duration = std::chrono::seconds{duration_s};
+    threads = std::max(threads, 1U);
+  }
+  catch (po::error &err)
+  {
+    std::cerr << boost::format("ERROR: %s\n\nUSAGE: %s <options>\n")
+                     % err.what() % argv[0]
+              << description << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  asio::io_context io_context;
+  totals results;
+  std::vector<std::shared_ptr<session>> sessions;
+
+  for (unsigned int index = 0; index < config.clients; ++index)
+  {
+    sessions.push_back(std::make_shared<session>(
+        io_context,
+        config,
+        config.window_sizes[index % config.window_sizes.size()],
+        seed + index,
+        results));
+    sessions.back()->start();
+  }
+
+  auto const start = clock_type::now();
+
+  // The run ends after its duration or when interrupted, whichever is
+  // first.  Both are handled on a strand so that either may cancel the
+  // other.
+  asio::io_context::strand control(io_context);
+  asio::steady_timer end_timer(io_context, config.duration);
+  asio::signal_set signals(io_context, SIGINT, SIGTERM);
+
+  auto const stop = [&]
+  {
+    end_timer.cancel();
+    signals.cancel();
+
+    for (auto const &each_session : sessions)
+    {
+      each_session->stop();
+    }
+  };
+
+  end_timer.async_wait(asio::bind_executor(
+      control,
+      [&](boost::system::error_code const &ec)
+      {
+        if (!ec)
+        {
+          stop();
+        }
+      }));
+
+  signals.async_wait(asio::bind_executor(
+      control,
+      [&](boost::system::error_code const &ec, int)
+      {
+        if (!ec)
+        {
+          stop();
+        }
+      }));
+
+  std::vector<std::thread> thread_pool;
+
+  for (unsigned int thr = 0; thr < threads; ++thr)
+  {
+    thread_pool.emplace_back([&] { io_context.run(); });
+  }
+
+  for (auto &pthread : thread_pool)
+  {
+    pthread.join();
+  }
+
+  report(std::cout, results, config.clients, clock_type::now() - start);
+
+  return EXIT_SUCCESS;
+}
@@ -1,25 +1,128 @@
 #include "application.hpp"
 #include <boost/format.hpp>
 #include <boost/program_options.hpp>
+#include <algorithm>
+#include <chrono>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <thread>
 #include <vector>
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace po = boost::program_options;
 
+namespace {
+
+// ==========================================================================
+// PIN_TO_CORE
+// ==========================================================================
+void pin_to_core(std::thread &thread, unsigned int core)
+{
+#ifdef __linux__
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(core, &cpus);
+
+  if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus)
+      != 0)
+  {
+    std::cerr << boost::format("WARNING: could not pin thread to core %d\n")
+                     % core;
+  }
+#else
+  std::cerr << "WARNING: thread affinity is not supported on this platform\n";
+#endif
+}
+
+}  // namespace
+
 int main(int argc, char *argv[])
 {
   uint16_t port = 4000;
   std::string threads;
   unsigned int concurrency = 0;
+  bool sharded = false;
+  bool affinity = false;
+  bool no_panorama = false;
+  std::string precision_name;
+  auto precision = textray::render_precision::double_precision;
+  int column_stride = 0;
+  unsigned int tick_interval_ms = 0;
+  unsigned int render_threads = 0;
+  uint16_t max_window_width = 0;
+  uint16_t max_window_height = 0;
+  std::size_t client_memory_mib = 0;
+  std::size_t max_input_buffer_kib = 0;
+  uint16_t admin_port = 0;
+  std::string metrics_file;
+  unsigned int metrics_interval_s = 0;
+  std::string recording_directory;
 
   po::options_description description("Available options");
   description.add_options()("help,h", "show this help message")(
       "port,p", po::value<uint16_t>(&port), "port identifier")(
       "threads,t",
       po::value<std::string>(&threads),
-      "number of threads of execution (0 for autodetect)");
+      "number of threads of execution (0 for autodetect)")(
+      "tick,k",
+      po::value<unsigned int>(&tick_interval_ms)->default_value(50),
+      "interval of each client's simulation tick in milliseconds; at most "
+      "one frame is rendered per tick")(
+      "render-threads,r",
+      po::value<unsigned int>(&render_threads),
+      "number of threads, apart from those of the network, on which frames "
+      "are rendered (0 to render on the network threads); one per core if "
+      "not given")(
+      "no-panorama",
+      "cast every frame's rays afresh, rather than taking them from a "
+      "panorama that is reused while turning on the spot")(
+      "precision",
+      po::value<std::string>(&precision_name)->default_value("double"),
+      "precision in which rays are cast: double, float or fixed")(
+      "column-stride",
+      po::value<int>(&column_stride)->default_value(8),
+      "interval at which columns of rays are cast before those between "
+      "them are refined; 1 casts every column")(
+      "max-width",
+      po::value<uint16_t>(&max_window_width)->default_value(512),
+      "widest window, in columns, that is rendered for a client")(
+      "max-height",
+      po::value<uint16_t>(&max_window_height)->default_value(256),
+      "tallest window, in rows, that is rendered for a client")(
+      "client-memory",
+      po::value<std::size_t>(&client_memory_mib)->default_value(32),
+      "memory budget of each client in MiB; clients whose windows would "
+      "exceed it have their windows shrunk")(
+      "max-input-buffer",
+      po::value<std::size_t>(&max_input_buffer_kib)->default_value(64),
+      "most input buffered for each client in KiB; any more is discarded")(
+      "sharded,s",
+      "run each thread on its own io_context with its own listener on the "
+      "port (using SO_REUSEPORT), pinning each client to the thread that "
+      "accepted it")(
+      "affinity,a",
+      "when sharded, pin each thread to its own CPU core")(
+      "admin-port",
+      po::value<uint16_t>(&admin_port),
+      "port on the loopback interface that serves a report of the server's "
+      "metrics to anyone who connects")(
+      "metrics-file",
+      po::value<std::string>(&metrics_file),
+      "file to which a report of the server's metrics is periodically "
+      "written")(
+      "metrics-interval",
+      po::value<unsigned int>(&metrics_interval_s)->default_value(15),
+      "interval between writes of the metrics file in seconds (at least 1)")(
+      "record-dir",
+      po::value<std::string>(&recording_directory),
+      "directory in which each client's input is recorded for replay by "
+      "textray_replay");
 
   po::positional_options_description pos_description;
   pos_description.add("port", -1);
@@ -45,6 +148,35 @@ int main(int argc, char *argv[])
       throw po::error("Port identifier must be specified");
     }
 
+    sharded = vm.count("sharded") != 0;
+    affinity = vm.count("affinity") != 0;
+    no_panorama = vm.count("no-panorama") != 0;
+
+    if (auto const parsed = textray::render_precision_from_name(precision_name);
+        parsed)
+    {
+      precision = *parsed;
+    }
+    else
+    {
+      throw po::error("Unknown precision: " + precision_name);
+    }
+
+    if (affinity && !sharded)
+    {
+      throw po::error("Thread affinity requires sharded mode");
+    }
+
+    if (metrics_interval_s == 0)
+    {
+      throw po::error("Metrics interval must be at least one second");
+    }
+
+    if (vm.count("render-threads") == 0)
+    {
+      render_threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+
     if (vm.count("threads") == 0)
     {
       concurrency = 1;
@@ -97,11 +229,61 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
   }
 
-  boost::asio::io_context io_context;
-  textray::application application{io_context, port};
+  textray::settings config;
+  config.tick_interval = std::chrono::milliseconds{tick_interval_ms};
+  config.render_threads = render_threads;
+  config.panorama = !no_panorama;
+  config.precision = precision;
+  config.column_stride = column_stride;
+  config.max_window_width = max_window_width;
+  config.max_window_height = max_window_height;
+  config.client_memory_budget = client_memory_mib * 1024 * 1024;
+  config.max_input_buffer = max_input_buffer_kib * 1024;
+  config.admin_port = admin_port;
+  config.metrics_file = metrics_file;
+  config.metrics_interval = std::chrono::seconds{metrics_interval_s};
+  config.recording_directory = recording_directory;
 
   std::vector<std::thread> thread_pool;
 
+  if (sharded)
+  {
+    // Each shard has its own io_context that is run by exactly one
+    // thread, so that a client's handlers never migrate between cores.
+    std::vector<std::unique_ptr<boost::asio::io_context>> shards;
+    std::vector<std::reference_wrapper<boost::asio::io_context>> shard_refs;
+
+    for (unsigned int shard = 0; shard < concurrency; ++shard)
+    {
+      shard_refs.emplace_back(
+          *shards.emplace_back(std::make_unique<boost::asio::io_context>(1)));
+    }
+
+    textray::application application{shard_refs, port, config};
+
+    auto const cores = std::max(std::thread::hardware_concurrency(), 1U);
+
+    for (unsigned int shard = 0; shard < concurrency; ++shard)
+    {
+      thread_pool.emplace_back([&, shard] { shards[shard]->run(); });
+
+      if (affinity)
+      {
+        pin_to_core(thread_pool.back(), shard % cores);
+      }
+    }
+
+    for (auto &pthread : thread_pool)
+    {
+      pthread.join();
+    }
+
+    return EXIT_SUCCESS;
+  }
+
+  boost::asio::io_context io_context;
+  textray::application application{io_context, port, config};
+
   for (unsigned int thr = 0; thr < concurrency; ++thr)
   {
     thread_pool.emplace_back([&] { io_context.run(); });
@@ -0,0 +1,133 @@
+#include "memory_budget.hpp"
+#include "render.hpp"
+#include <terminalpp/element.hpp>
+#include <algorithm>
+
+namespace textray {
+
+namespace {
+
+// The number of copies of the frame that are held for each client: its
+// canvas, the camera's image, the frame being rendered into it, the frame
+// rendered by the scheduler and waiting to be drawn, and the terminal's
+// record of what is on the screen.
+constexpr std::size_t frame_copies = 5;
+
+constexpr std::size_t bytes_per_cell =
+    frame_copies * sizeof(terminalpp::element);
+
+// The connection's fixed costs, which are dominated by the zlib stream
+// that MCCP uses to compress its output (about 256KiB with the default
+// window and memory levels), plus the Telnet session and its options.
+constexpr std::size_t connection_overhead = 320 * 1024;
+
+// ==========================================================================
+// FIXED_COST
+// ==========================================================================
+std::size_t fixed_cost(settings const &config)
+{
+  return connection_overhead + config.max_input_buffer;
+}
+
+// ==========================================================================
+// BYTES_PER_CELL_COLUMN
+// ==========================================================================
+// The memory that grows with the width of the window alone: the camera's
+// panorama, if it has one.
+std::size_t bytes_per_cell_column(settings const &config)
+{
+  return config.panorama ? panorama::max_bytes_per_cell_column() : 0;
+}
+
+// ==========================================================================
+// WINDOW_COST
+// ==========================================================================
+std::size_t window_cost(
+    std::size_t width, std::size_t height, settings const &config)
+{
+  return (width * height * bytes_per_cell)
+         + (width * bytes_per_cell_column(config));
+}
+
+}  // namespace
+
+// ==========================================================================
+// ESTIMATED_CLIENT_MEMORY
+// ==========================================================================
+std::size_t estimated_client_memory(
+    terminalpp::extent window_size, settings const &config)
+{
+  return fixed_cost(config)
+         + window_cost(
+             static_cast<std::size_t>(window_size.width_),
+             static_cast<std::size_t>(window_size.height_),
+             config);
+}
+
+// ==========================================================================
+// CLAMP_WINDOW_SIZE
+// ==========================================================================
+terminalpp::extent clamp_window_size(
+    terminalpp::extent requested_size, settings const &config)
+{
+  auto width = std::min<std::size_t>(
+      std::max<terminalpp::coordinate_type>(requested_size.width_, 0),
+      config.max_window_width);
+  auto height = std::min<std::size_t>(
+      std::max<terminalpp::coordinate_type>(requested_size.height_, 0),
+      config.max_window_height);
+
+  auto const budget = config.client_memory_budget > fixed_cost(config)
+                          ? config.client_memory_budget - fixed_cost(config)
+                          : 0;
+  auto const fits = [&config, budget](std::size_t w, std::size_t h)
+  { return window_cost(w, h, config) <= budget; };
+
+  auto const scaled = [](std::size_t length, double scale)
+  {
+    return std::max<std::size_t>(
+        static_cast<std::size_t>(length * scale), 1);
+  };
+
+  if (!fits(width, height))
+  {
+    // The largest scale at which the window fits is found by bisection,
+    // since the cost of the window grows with both its area and its width.
+    double fitting_scale = 0;
+    double failing_scale = 1;
+
+    for (int step = 0; step < 32; ++step)
+    {
+      auto const scale = (fitting_scale + failing_scale) / 2;
+
+      if (fits(scaled(width, scale), scaled(height, scale)))
+      {
+        fitting_scale = scale;
+      }
+      else
+      {
+        failing_scale = scale;
+      }
+    }
+
+    width = scaled(width, fitting_scale);
+    height = scaled(height, fitting_scale);
+
+    // A very narrow window may have been stretched to its minimum.
+    while (!fits(width, height) && height > 1)
+    {
+      --height;
+    }
+
+    while (!fits(width, height) && width > 1)
+    {
+      --width;
+    }
+  }
+
+  return {
+      static_cast<terminalpp::coordinate_type>(width),
+      static_cast<terminalpp::coordinate_type>(height)};
+}
+
+}  // namespace textray
@@ -0,0 +1,243 @@
+#include "metrics.hpp"
+#include <boost/format.hpp>
+#include <mutex>
+#include <ostream>
+#include <unordered_set>
+
+namespace textray {
+
+namespace {
+
+struct counter_description
+{
+  char const *name;
+  char const *help;
+  std::atomic<std::uint64_t> client_metrics::*member;
+};
+
+constexpr counter_description counters[] = {
+    {"textray_input_tokens_total",
+     "Input tokens decoded from clients.",
+     &client_metrics::input_tokens},
+    {"textray_ticks_total",
+     "Simulation ticks run for clients.",
+     &client_metrics::ticks},
+    {"textray_repaint_requests_total",
+     "Requests to repaint a client's window.",
+     &client_metrics::repaint_requests},
+    {"textray_repaints_coalesced_total",
+     "Repaint requests merged into a repaint that was already pending.",
+     &client_metrics::repaints_coalesced},
+    {"textray_frames_total",
+     "Frames rendered and sent to clients.",
+     &client_metrics::frames},
+    {"textray_frames_dropped_total",
+     "Frames not rendered because the client's connection had died.",
+     &client_metrics::frames_dropped},
+    {"textray_bytes_written_total",
+     "Bytes written to clients, before compression.",
+     &client_metrics::bytes_written},
+    {"textray_bytes_sent_total",
+     "Bytes sent to clients' sockets, after compression.",
+     &client_metrics::bytes_sent},
+    {"textray_window_clamps_total",
+     "Window sizes reduced to fit the limits on window size and memory.",
+     &client_metrics::window_clamps},
+    {"textray_input_bytes_discarded_total",
+     "Input bytes discarded because a client's input buffer was full.",
+     &client_metrics::input_bytes_discarded},
+};
+
+struct summary_description
+{
+  char const *name;
+  char const *help;
+  histogram client_metrics::*member;
+};
+
+constexpr summary_description summaries[] = {
+    {"textray_render_seconds",
+     "Time taken to render a frame.",
+     &client_metrics::render_time_us},
+    {"textray_frame_wait_seconds",
+     "Time from a frame being scheduled to its rendering beginning.",
+     &client_metrics::frame_wait_us},
+    {"textray_input_latency_seconds",
+     "Time from a keypress arriving to its frame being sent.",
+     &client_metrics::input_latency_us},
+};
+
+constexpr double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+// ==========================================================================
+// ACCUMULATE
+// ==========================================================================
+void accumulate(client_metrics &total, client_metrics const &metrics)
+{
+  for (auto const &counter : counters)
+  {
+    (total.*counter.member) += (metrics.*counter.member).load();
+  }
+
+  for (auto const &summary : summaries)
+  {
+    (total.*summary.member).merge(metrics.*summary.member);
+  }
+}
+
+// ==========================================================================
+// WRITE_SUMMARY
+// ==========================================================================
+void write_summary(
+    std::ostream &out,
+    char const *name,
+    std::string const &labels,
+    histogram const &microseconds)
+{
+  auto const separator = labels.empty() ? "" : ",";
+
+  for (auto const q : quantiles)
+  {
+    out << boost::format("%s{%s%squantile=\"%g\"} %.6f\n") % name % labels
+               % separator % q % (microseconds.quantile(q) / 1e6);
+  }
+
+  auto const braced_labels = labels.empty() ? labels : "{" + labels + "}";
+  out << boost::format("%s_sum%s %.6f\n") % name % braced_labels
+             % (microseconds.sum() / 1e6);
+  out << boost::format("%s_count%s %d\n") % name % braced_labels
+             % microseconds.count();
+}
+
+}  // namespace
+
+// ==========================================================================
+// SERVER_METRICS::IMPLEMENTATION STRUCTURE
+// ==========================================================================
+struct server_metrics::impl
+{
+  mutable std::mutex mutex_;
+  std::unordered_set<client_metrics const *> live_;
+  client_metrics retired_;
+  std::uint64_t next_id_{0};
+};
+
+// ==========================================================================
+// CONSTRUCTOR
+// ==========================================================================
+server_metrics::server_metrics() : pimpl_(std::make_shared<impl>())
+{
+}
+
+// ==========================================================================
+// DESTRUCTOR
+// ==========================================================================
+server_metrics::~server_metrics() = default;
+
+// ==========================================================================
+// MAKE_CLIENT_METRICS
+// ==========================================================================
+std::shared_ptr<client_metrics> server_metrics::make_client_metrics()
+{
+  auto const lock = std::unique_lock<std::mutex>(pimpl_->mutex_);
+
+  auto *metrics = new client_metrics;  // NOLINT
+  metrics->id = pimpl_->next_id_++;
+  pimpl_->live_.insert(metrics);
+
+  // The deleter shares ownership of the server's metrics, so that they
+  // remain valid for as long as any client's metrics do.
+  return std::shared_ptr<client_metrics>(
+      metrics,
+      [server = pimpl_](client_metrics *metrics)
+      {
+        {
+          auto const lock = std::unique_lock<std::mutex>(server->mutex_);
+          accumulate(server->retired_, *metrics);
+          server->live_.erase(metrics);
+        }
+
+        delete metrics;  // NOLINT
+      });
+}
+
+// ==========================================================================
+// WRITE_PROMETHEUS
+// ==========================================================================
+void server_metrics::write_prometheus(std::ostream &out, bool per_client) const
+{
+  auto const lock = std::unique_lock<std::mutex>(pimpl_->mutex_);
+
+  client_metrics total;
+  accumulate(total, pimpl_->retired_);
+
+  for (auto const *metrics : pimpl_->live_)
+  {
+    accumulate(total, *metrics);
+  }
+
+  auto const client_label = [](client_metrics const &metrics)
+  { return (boost::format("client=\"%d\"") % metrics.id).str(); };
+
+  std::uint64_t memory_bytes = 0;
+
+  for (auto const *metrics : pimpl_->live_)
+  {
+    memory_bytes += metrics->memory_bytes;
+  }
+
+  out << "# HELP textray_clients Connected clients.\n"
+      << "# TYPE textray_clients gauge\n"
+      << "textray_clients " << pimpl_->live_.size() << "\n";
+
+  out << "# HELP textray_client_memory_bytes Estimated memory used by "
+         "connected clients.\n"
+      << "# TYPE textray_client_memory_bytes gauge\n"
+      << "textray_client_memory_bytes " << memory_bytes << "\n";
+
+  if (per_client)
+  {
+    for (auto const *metrics : pimpl_->live_)
+    {
+      out << boost::format("textray_client_memory_bytes{%s} %d\n")
+                 % client_label(*metrics) % metrics->memory_bytes.load();
+    }
+  }
+
+  for (auto const &counter : counters)
+  {
+    out << boost::format("# HELP %s %s\n# TYPE %s counter\n") % counter.name
+               % counter.help % counter.name;
+    out << counter.name << " " << (total.*counter.member).load() << "\n";
+
+    if (per_client)
+    {
+      for (auto const *metrics : pimpl_->live_)
+      {
+        out << boost::format("%s{%s} %d\n") % counter.name
+                   % client_label(*metrics) % (metrics->*counter.member).load();
+      }
+    }
+  }
+
+  for (auto const &summary : summaries)
+  {
+    out << boost::format("# HELP %s %s\n# TYPE %s summary\n") % summary.name
+               % summary.help % summary.name;
+    write_summary(out, summary.name, "", total.*summary.member);
+
+    if (per_client)
+    {
+      for (auto const *metrics : pimpl_->live_)
+      {
+        write_summary(
+            out,
+            summary.name,
+            client_label(*metrics),
+            metrics->*summary.member);
+      }
+    }
+  }
+}
+
+}  // namespace textray
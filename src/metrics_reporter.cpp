@@ -0,0 +1,207 @@
+#include "metrics_reporter.hpp"
+#include "metrics.hpp"
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/make_unique.hpp>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+namespace textray {
+
+// ==========================================================================
+// METRICS_REPORTER::IMPLEMENTATION STRUCTURE
+// ==========================================================================
+struct metrics_reporter::impl
+{
+  // ======================================================================
+  // CONSTRUCTOR
+  // ======================================================================
+  impl(
+      boost::asio::io_context &io_context,
+      server_metrics const &metrics,
+      settings const &config)
+    : metrics_(metrics),
+      strand_(io_context),
+      acceptor_(io_context),
+      timer_(io_context),
+      metrics_file_(config.metrics_file),
+      metrics_interval_(config.metrics_interval)
+  {
+    if (config.admin_port != 0)
+    {
+      // The admin port exposes the server's internals, and so is only
+      // ever bound to the loopback interface.
+      auto const endpoint = boost::asio::ip::tcp::endpoint(
+          boost::asio::ip::address_v4::loopback(), config.admin_port);
+
+      acceptor_.open(endpoint.protocol());
+      acceptor_.set_option(
+          boost::asio::ip::tcp::acceptor::reuse_address(true));
+      acceptor_.bind(endpoint);
+      acceptor_.listen();
+      accept_next();
+    }
+
+    // A zero interval would rewrite the file in a busy loop, and so
+    // disables it instead.
+    if (!metrics_file_.empty()
+        && metrics_interval_ > std::chrono::steady_clock::duration::zero())
+    {
+      schedule_file_write();
+    }
+  }
+
+  // ======================================================================
+  // SHUTDOWN
+  // ======================================================================
+  void shutdown()
+  {
+    boost::asio::post(
+        strand_,
+        [this]
+        {
+          boost::system::error_code ec;
+          acceptor_.close(ec);
+          timer_.cancel();
+        });
+  }
+
+ private:
+  // ======================================================================
+  // ACCEPT_NEXT
+  // ======================================================================
+  void accept_next()
+  {
+    acceptor_.async_accept(boost::asio::bind_executor(
+        strand_,
+        [this](
+            boost::system::error_code const &ec,
+            boost::asio::ip::tcp::socket socket)
+        {
+          if (!ec)
+          {
+            send_report(std::move(socket));
+          }
+
+          if (acceptor_.is_open())
+          {
+            accept_next();
+          }
+        }));
+  }
+
+  // ======================================================================
+  // SEND_REPORT
+  // ======================================================================
+  void send_report(boost::asio::ip::tcp::socket &&socket)
+  {
+    // Anyone connecting to the admin port receives a report of the
+    // metrics of the server and each of its clients, after which the
+    // connection is closed.
+    std::ostringstream report;
+    metrics_.write_prometheus(report, true);
+
+    auto const connection =
+        std::make_shared<std::pair<boost::asio::ip::tcp::socket, std::string>>(
+            std::move(socket), report.str());
+
+    boost::asio::async_write(
+        connection->first,
+        boost::asio::buffer(connection->second),
+        [connection](boost::system::error_code const &, std::size_t)
+        {
+          boost::system::error_code ec;
+          connection->first.shutdown(
+              boost::asio::ip::tcp::socket::shutdown_both, ec);
+          connection->first.close(ec);
+        });
+  }
+
+  // ======================================================================
+  // SCHEDULE_FILE_WRITE
+  // ======================================================================
+  void schedule_file_write()
+  {
+    timer_.expires_after(metrics_interval_);
+    timer_.async_wait(boost::asio::bind_executor(
+        strand_,
+        [this](boost::system::error_code const &ec)
+        {
+          if (!ec)
+          {
+            write_file();
+            schedule_file_write();
+          }
+        }));
+  }
+
+  // ======================================================================
+  // WRITE_FILE
+  // ======================================================================
+  void write_file() const
+  {
+    // The report is written to a temporary file that then replaces the
+    // old one, so that a reader never sees a partially-written report.
+    auto const temporary_file = metrics_file_ + ".tmp";
+
+    {
+      std::ofstream out(temporary_file, std::ios::trunc);
+      metrics_.write_prometheus(out, false);
+
+      if (!out)
+      {
+        std::cerr << "WARNING: could not write metrics to " << temporary_file
+                  << "\n";
+        return;
+      }
+    }
+
+    if (std::rename(temporary_file.c_str(), metrics_file_.c_str()) != 0)
+    {
+      std::cerr << "WARNING: could not replace " << metrics_file_ << "\n";
+    }
+  }
+
+  server_metrics const &metrics_;
+
+  // The acceptor and timer are only ever accessed from this strand, so
+  // that shutting down does not race with their handlers.
+  boost::asio::io_context::strand strand_;
+  boost::asio::ip::tcp::acceptor acceptor_;
+  boost::asio::steady_timer timer_;
+  std::string metrics_file_;
+  std::chrono::steady_clock::duration metrics_interval_;
+};
+
+// ==========================================================================
+// CONSTRUCTOR
+// ==========================================================================
+metrics_reporter::metrics_reporter(
+    boost::asio::io_context &io_context,
+    server_metrics const &metrics,
+    settings const &config)
+  : pimpl_(boost::make_unique<impl>(io_context, metrics, config))
+{
+}
+
+// ==========================================================================
+// DESTRUCTOR
+// ==========================================================================
+metrics_reporter::~metrics_reporter() = default;
+
+// ==========================================================================
+// SHUTDOWN
+// ==========================================================================
+void metrics_reporter::shutdown()
+{
+  pimpl_->shutdown();
+}
+
+}  // namespace textray
@@ -0,0 +1,439 @@
+#include "recording.hpp"
+#include "metrics.hpp"
+#include <boost/asio/post.hpp>
+#include <boost/make_unique.hpp>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace textray {
+
+namespace {
+
+// A recording is a header followed by a sequence of events.  Each event is
+// its kind, its time in microseconds, and then either a width and height
+// or a length-prefixed string.  All integers are little-endian.
+constexpr char recording_header[] = "textray-recording 1\n";
+
+// ==========================================================================
+// WRITE_INTEGER
+// ==========================================================================
+template <class Integer>
+void write_integer(std::ostream &out, Integer value)
+{
+  for (std::size_t index = 0; index < sizeof(Integer); ++index)
+  {
+    out.put(static_cast<char>((value >> (index * 8)) & 0xFF));
+  }
+}
+
+// ==========================================================================
+// READ_INTEGER
+// ==========================================================================
+template <class Integer>
+Integer read_integer(std::istream &in)
+{
+  Integer value = 0;
+
+  for (std::size_t index = 0; index < sizeof(Integer); ++index)
+  {
+    auto const byte = in.get();
+
+    // At the end of the stream, the stream is left failed for the caller to
+    // notice, rather than the end being read as a byte.
+    if (byte == std::char_traits<char>::eof())
+    {
+      break;
+    }
+
+    value |= static_cast<Integer>(static_cast<unsigned char>(byte))
+             << (index * 8);
+  }
+
+  return value;
+}
+
+// ==========================================================================
+// RECORDING_ENDPOINT
+// ==========================================================================
+class recording_endpoint final : public connection_endpoint
+{
+ public:
+  // ======================================================================
+  // CONSTRUCTOR
+  // ======================================================================
+  recording_endpoint(
+      std::unique_ptr<connection_endpoint> endpoint,
+      std::string const &filename)
+    : endpoint_(std::move(endpoint)),
+      out_(filename, std::ios::binary | std::ios::trunc),
+      start_(std::chrono::steady_clock::now())
+  {
+    out_ << recording_header;
+
+    if (!out_)
+    {
+      std::cerr << "WARNING: could not record to " << filename << "\n";
+    }
+  }
+
+  // ======================================================================
+  // IS_ALIVE
+  // ======================================================================
+  [[nodiscard]] bool is_alive() const override
+  {
+    return endpoint_->is_alive();
+  }
+
+  // ======================================================================
+  // CLOSE
+  // ======================================================================
+  void close() override
+  {
+    endpoint_->close();
+  }
+
+  // ======================================================================
+  // ASYNC_READ
+  // ======================================================================
+  void async_read(
+      std::function<void(serverpp::bytes)> const &data_continuation,
+      std::function<void()> const &read_complete_continuation) override
+  {
+    endpoint_->async_read(
+        [this, data_continuation](serverpp::bytes data)
+        {
+          record(
+              recorded_event::kind::data,
+              {reinterpret_cast<char const *>(data.data()), data.size()});
+          data_continuation(data);
+        },
+        read_complete_continuation);
+  }
+
+  // ======================================================================
+  // WRITE
+  // ======================================================================
+  void write(serverpp::bytes data) override
+  {
+    endpoint_->write(data);
+  }
+
+  // ======================================================================
+  // ASYNC_GET_TERMINAL_TYPE
+  // ======================================================================
+  void async_get_terminal_type(
+      std::function<void(std::string const &)> const &continuation) override
+  {
+    endpoint_->async_get_terminal_type(
+        [this, continuation](std::string const &type)
+        {
+          record(recorded_event::kind::terminal_type, type);
+          continuation(type);
+        });
+  }
+
+  // ======================================================================
+  // ON_WINDOW_SIZE_CHANGED
+  // ======================================================================
+  void on_window_size_changed(
+      std::function<void(std::uint16_t, std::uint16_t)> const &continuation)
+      override
+  {
+    endpoint_->on_window_size_changed(
+        [this, continuation](std::uint16_t width, std::uint16_t height)
+        {
+          if (out_)
+          {
+            write_event_header(recorded_event::kind::window_size);
+            write_integer(out_, width);
+            write_integer(out_, height);
+          }
+
+          continuation(width, height);
+        });
+  }
+
+  // ======================================================================
+  // SET_METRICS
+  // ======================================================================
+  void set_metrics(std::shared_ptr<client_metrics> metrics) override
+  {
+    endpoint_->set_metrics(std::move(metrics));
+  }
+
+ private:
+  // ======================================================================
+  // RECORD
+  // ======================================================================
+  void record(recorded_event::kind type, std::string const &text)
+  {
+    if (out_)
+    {
+      write_event_header(type);
+      write_integer(out_, static_cast<std::uint32_t>(text.size()));
+      out_.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+  }
+
+  // ======================================================================
+  // WRITE_EVENT_HEADER
+  // ======================================================================
+  void write_event_header(recorded_event::kind type)
+  {
+    auto const time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_);
+
+    out_.put(static_cast<char>(type));
+    write_integer(out_, static_cast<std::uint64_t>(time.count()));
+  }
+
+  std::unique_ptr<connection_endpoint> endpoint_;
+  std::ofstream out_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// ==========================================================================
+// REPLAY_ENDPOINT
+// ==========================================================================
+class replay_endpoint final : public connection_endpoint
+{
+ public:
+  // ======================================================================
+  // CONSTRUCTOR
+  // ======================================================================
+  replay_endpoint(
+      boost::asio::io_context &io_context, std::vector<recorded_event> events)
+    : io_context_(io_context), events_(std::move(events))
+  {
+  }
+
+  // ======================================================================
+  // IS_ALIVE
+  // ======================================================================
+  [[nodiscard]] bool is_alive() const override
+  {
+    return alive_;
+  }
+
+  // ======================================================================
+  // CLOSE
+  // ======================================================================
+  void close() override
+  {
+    alive_ = false;
+  }
+
+  // ======================================================================
+  // ASYNC_READ
+  // ======================================================================
+  void async_read(
+      std::function<void(serverpp::bytes)> const &data_continuation,
+      std::function<void()> const &read_complete_continuation) override
+  {
+    // The read completes in a handler of its own, as a read from a socket
+    // would, rather than recursing into the caller.
+    boost::asio::post(
+        io_context_,
+        [lifetime = std::weak_ptr<int>(lifetime_),
+         this,
+         data_continuation,
+         read_complete_continuation]
+        {
+          if (lifetime.lock())
+          {
+            replay_next(data_continuation, read_complete_continuation);
+          }
+        });
+  }
+
+  // ======================================================================
+  // WRITE
+  // ======================================================================
+  void write(serverpp::bytes data) override
+  {
+    if (metrics_)
+    {
+      metrics_->bytes_written += data.size();
+      metrics_->bytes_sent += data.size();
+    }
+  }
+
+  // ======================================================================
+  // ASYNC_GET_TERMINAL_TYPE
+  // ======================================================================
+  void async_get_terminal_type(
+      std::function<void(std::string const &)> const &continuation) override
+  {
+    terminal_type_requests_.emplace_back(continuation);
+  }
+
+  // ======================================================================
+  // ON_WINDOW_SIZE_CHANGED
+  // ======================================================================
+  void on_window_size_changed(
+      std::function<void(std::uint16_t, std::uint16_t)> const &continuation)
+      override
+  {
+    on_window_size_changed_ = continuation;
+  }
+
+  // ======================================================================
+  // SET_METRICS
+  // ======================================================================
+  void set_metrics(std::shared_ptr<client_metrics> metrics) override
+  {
+    metrics_ = std::move(metrics);
+  }
+
+ private:
+  // ======================================================================
+  // REPLAY_NEXT
+  // ======================================================================
+  void replay_next(
+      std::function<void(serverpp::bytes)> const &data_continuation,
+      std::function<void()> const &read_complete_continuation)
+  {
+    while (alive_ && next_event_ != events_.size())
+    {
+      auto const &event = events_[next_event_++];
+
+      switch (event.type)
+      {
+        case recorded_event::kind::data:
+          data_continuation(
+              {reinterpret_cast<serverpp::byte const *>(event.text.data()),
+               event.text.size()});
+          read_complete_continuation();
+          return;
+
+        case recorded_event::kind::window_size:
+          if (on_window_size_changed_)
+          {
+            on_window_size_changed_(event.width, event.height);
+          }
+          break;
+
+        case recorded_event::kind::terminal_type:
+          for (auto const &callback : terminal_type_requests_)
+          {
+            callback(event.text);
+          }
+
+          terminal_type_requests_.clear();
+          break;
+      }
+    }
+
+    alive_ = false;
+    read_complete_continuation();
+  }
+
+  boost::asio::io_context &io_context_;
+  std::vector<recorded_event> events_;
+  std::size_t next_event_{0};
+  bool alive_{true};
+  std::shared_ptr<client_metrics> metrics_;
+
+  std::function<void(std::uint16_t, std::uint16_t)> on_window_size_changed_;
+  std::vector<std::function<void(std::string const &)>>
+      terminal_type_requests_;
+
+  // Handlers that have been posted hold this weakly, so that they can
+  // detect that the endpoint has been destroyed.
+  std::shared_ptr<int> lifetime_{std::make_shared<int>(0)};
+};
+
+}  // namespace
+
+// ==========================================================================
+// MAKE_RECORDING_ENDPOINT
+// ==========================================================================
+std::unique_ptr<connection_endpoint> make_recording_endpoint(
+    std::unique_ptr<connection_endpoint> endpoint, std::string const &filename)
+{
+  return boost::make_unique<recording_endpoint>(std::move(endpoint), filename);
+}
+
+// ==========================================================================
+// LOAD_RECORDING
+// ==========================================================================
+std::vector<recorded_event> load_recording(std::string const &filename)
+{
+  std::ifstream in(filename, std::ios::binary);
+  std::string header(sizeof(recording_header) - 1, '\0');
+
+  in.seekg(0, std::ios::end);
+  auto const file_size = in.tellg();
+  in.seekg(0, std::ios::beg);
+
+  if (!in.read(header.data(), static_cast<std::streamsize>(header.size()))
+      || header != recording_header)
+  {
+    throw std::runtime_error(filename + " is not a textray recording");
+  }
+
+  std::vector<recorded_event> events;
+
+  for (auto type = in.get(); type != std::char_traits<char>::eof();
+       type = in.get())
+  {
+    recorded_event event;
+    event.type = static_cast<recorded_event::kind>(type);
+    event.time = std::chrono::microseconds(read_integer<std::uint64_t>(in));
+
+    switch (event.type)
+    {
+      case recorded_event::kind::window_size:
+        event.width = read_integer<std::uint16_t>(in);
+        event.height = read_integer<std::uint16_t>(in);
+        break;
+
+      case recorded_event::kind::data:
+      case recorded_event::kind::terminal_type:
+      {
+        auto const length = read_integer<std::uint32_t>(in);
+
+        // A length that runs past the end of the file belongs to a partial
+        // event, and is not trusted to size the text.
+        if (!in || std::streamoff{length} > file_size - in.tellg())
+        {
+          in.setstate(std::ios::failbit);
+          break;
+        }
+
+        event.text.resize(length);
+        in.read(
+            event.text.data(), static_cast<std::streamsize>(event.text.size()));
+        break;
+      }
+
+      default:
+        throw std::runtime_error(filename + " contains an unknown event");
+    }
+
+    if (!in)
+    {
+      // A recording that ends part way through an event was probably cut
+      // short by the server stopping, so the complete events are kept.
+      std::cerr << "WARNING: " << filename << " ends with a partial event\n";
+      break;
+    }
+
+    events.push_back(std::move(event));
+  }
+
+  return events;
+}
+
+// ==========================================================================
+// MAKE_REPLAY_ENDPOINT
+// ==========================================================================
+std::unique_ptr<connection_endpoint> make_replay_endpoint(
+    boost::asio::io_context &io_context, std::vector<recorded_event> events)
+{
+  return boost::make_unique<replay_endpoint>(io_context, std::move(events));
+}
+
+}  // namespace textray
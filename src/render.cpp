@@ -0,0 +1,2220 @@
+#include "render.hpp"
+#include "fixed16_16.hpp"
+#include "lightmap.hpp"
+#include "texture.hpp"
+#include "trace.hpp"
+#include <terminalpp/palette.hpp>
+#include <boost/format.hpp>
+#include <boost/make_unique.hpp>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <utility>
+
+namespace {
+
+auto const ceiling_colour =
+    terminalpp::colour{terminalpp::true_colour{0xDE, 0xC9, 0xC5}};
+auto const floor_colour =
+    terminalpp::colour{terminalpp::true_colour{0x18, 0x2B, 0x8C}};
+
+constexpr double textel_aspect = 2.0;  // textel_height / textel_width
+constexpr double wall_height = 1.0;    // height of walls, in world units
+
+// The colour of a wall is currently encoded in the character of its fill.
+terminalpp::colour wall_colour(textray::tile const &wall)
+{
+  return terminalpp::low_colour{
+      static_cast<terminalpp::graphics::colour>(wall.fill.glyph_.character_)};
+}
+
+double lerp0(int high, double percentage)
+{
+  return (high * percentage) / 100;
+}
+
+// Top glyph with dots blanked for height (so a height of 3.1 would only have
+// lower dots, whereas 3.8 would have only high dots missing
+terminalpp::glyph top_glyph(double const height)
+{
+  using namespace terminalpp::literals;  // NOLINT
+
+  double const adjusted_height = 1 - (height - static_cast<int>(height));
+  return adjusted_height < 0.25   ? R"(\U28C0)"_ete.glyph_
+         : adjusted_height < 0.50 ? R"(\U28E4)"_ete.glyph_
+         : adjusted_height < 0.75 ? R"(\U28F6)"_ete.glyph_
+                                  : R"(\U28FF)"_ete.glyph_;
+}
+
+// The top ceiling glyph will be adjusted so that there is always
+// 3/4 of a character's height between the top of the wall and the
+// ceiling.
+terminalpp::glyph top_ceiling_glyph(double const height)
+{
+  using namespace terminalpp::literals;  // NOLINT
+
+  double const adjusted_height = 1 - (height - static_cast<int>(height));
+  return adjusted_height < 0.25   ? R"(\U28FF)"_ete.glyph_
+         : adjusted_height < 0.50 ? R"(\U283F)"_ete.glyph_
+         : adjusted_height < 0.75 ? R"(\U281B)"_ete.glyph_
+                                  : R"(\U2809)"_ete.glyph_;
+}
+
+// Likewise bottom glyphs miss dots from the bottom up.
+terminalpp::glyph bottom_glyph(double const height)
+{
+  using namespace terminalpp::literals;  // NOLINT
+
+  double const adjusted_height = height - static_cast<int>(height);
+  return adjusted_height < 0.25   ? R"(\U2809)"_ete.glyph_
+         : adjusted_height < 0.50 ? R"(\U281B)"_ete.glyph_
+         : adjusted_height < 0.75 ? R"(\U283F)"_ete.glyph_
+                                  : R"(\U28FF)"_ete.glyph_;
+}
+
+// Likewise bottom floor glyphs maintain 3/4 of a character's
+// distance at all times.
+terminalpp::glyph bottom_floor_glyph(double const height)
+{
+  using namespace terminalpp::literals;  // NOLINT
+
+  double const adjusted_height = height - static_cast<int>(height);
+  return adjusted_height < 0.25   ? R"(\U28FF)"_ete.glyph_
+         : adjusted_height < 0.50 ? R"(\U28F6)"_ete.glyph_
+         : adjusted_height < 0.75 ? R"(\U28E4)"_ete.glyph_
+                                  : R"(\U28C0)"_ete.glyph_;
+}
+
+// The ceiling and floor darken towards the horizon in steps of one row.
+double ceiling_darkness(int row, terminalpp::extent size)
+{
+  auto const max_ceiling_row = size.height_ / 2;
+  auto const dropoff_per_segment = 100 / std::max(max_ceiling_row - 1, 1);
+  auto const dropoff = dropoff_per_segment * row;
+
+  return lerp0(90, dropoff);
+}
+
+double floor_darkness(int row, terminalpp::extent size)
+{
+  auto const min_floor_row = size.height_ / 2;
+  auto const dropoff_per_segment =
+      100 / std::max((size.height_ - min_floor_row) - 1, 1);
+  auto const dropoff = dropoff_per_segment * (row - min_floor_row);
+
+  return 90 - lerp0(90, dropoff);
+}
+
+// The shade rows of the colours of each texture's palette, which are found
+// the first time that a texture is met.
+class palette_shade_rows
+{
+ public:
+  explicit palette_shade_rows(textray::shade_table const &shades)
+    : shades_(shades)
+  {
+  }
+
+  std::vector<std::size_t> const &operator()(textray::texture const &surface)
+  {
+    for (auto const &[known, rows] : rows_)
+    {
+      if (known == &surface)
+      {
+        return rows;
+      }
+    }
+
+    auto &[known, rows] =
+        rows_.emplace_back(&surface, std::vector<std::size_t>{});
+
+    for (auto const &colour : surface.palette())
+    {
+      rows.push_back(shades_.row_of(colour));
+    }
+
+    return rows;
+  }
+
+ private:
+  textray::shade_table const &shades_;
+  std::vector<std::pair<textray::texture const *, std::vector<std::size_t>>>
+      rows_;
+};
+
+// The scale of the vertical field of view, based on the viewport's aspect
+// ratio (taking the textel aspect ratio into consideration as well).
+double vertical_fov_scale(terminalpp::extent size, double fov)
+{
+  return tan(fov / 2) / size.width_ * size.height_ * textel_aspect;
+}
+
+// The perpendicular distance of the floor or ceiling seen through the
+// centre of each row of a view, which depends only on the view's size and
+// field of view, and so is kept with the view's panorama from one frame to
+// the next.  The rows may be finer than cells, with the given number to
+// each row of cells.
+struct surface_rows
+{
+  terminalpp::extent size;
+  int rows_per_cell{0};
+  double fov{0};
+  std::vector<double> distances;  // 0 for a row at the horizon
+};
+
+// Fills the rows for the given view, unless they already hold them.
+surface_rows const &update_surface_rows(
+    surface_rows &cache,
+    terminalpp::extent size,
+    int rows_per_cell,
+    double fov)
+{
+  if (cache.distances.empty() || cache.size != size
+      || cache.rows_per_cell != rows_per_cell || cache.fov != fov)
+  {
+    cache.size = size;
+    cache.rows_per_cell = rows_per_cell;
+    cache.fov = fov;
+
+    // A surface at a perpendicular distance d is seen at the same row as
+    // the foot (or head) of a wall at that distance, which lies half the
+    // wall's projected height from the horizon.
+    auto const rows = size.height_ * rows_per_cell;
+    auto const horizon = rows / 2.0;
+    auto const projection = rows * wall_height
+                            / (2 * vertical_fov_scale(size, fov)
+                               * textel_aspect);
+
+    cache.distances.resize(rows);
+
+    for (int row = 0; row < rows; ++row)
+    {
+      auto const from_horizon = std::abs(row + 0.5 - horizon);
+      cache.distances[row] =
+          from_horizon < 0.5 ? 0 : projection / from_horizon;
+    }
+  }
+
+  return cache;
+}
+
+// Casts the textured floor and ceiling of a view a row at a time.  The
+// point on the floorplan seen by a row's first column, and the step to
+// each next column, are found once for the row; each column then steps
+// from the last without a division.  Columns whose tile has no texture
+// for that surface are left to the plain gradient.
+class surface_casting
+{
+ public:
+  surface_casting(
+      surface_rows const &rows,
+      terminalpp::extent size,
+      int rows_per_cell,
+      textray::floorplan const &plan,
+      textray::shade_table const &shades,
+      textray::vector2d const &position,
+      double heading,
+      double fov,
+      bool textured)
+    : rows_(rows),
+      grid_{
+          size.width_,
+          static_cast<terminalpp::coordinate_type>(
+              size.height_ * rows_per_cell)},
+      plan_(plan),
+      shades_(shades),
+      palette_rows_(shades),
+      position_(position),
+      textured_(textured)
+  {
+    auto const dir = textray::vector2d::from_angle(heading);
+    auto const right = textray::vector2d::from_angle(heading - M_PI / 2);
+    auto const tan_half_fov = tan(fov / 2);
+
+    // The rays of the columns, scaled so that each travels a unit along
+    // the heading, are dir + right * tan_half_fov * camera_x, for camera_x
+    // from -1 + 1/width in steps of 2/width.
+    first_ray_ = dir + right * (tan_half_fov * (1.0 / size.width_ - 1));
+    column_step_ = right * (tan_half_fov * 2 / size.width_);
+
+    // The width of a tile in columns, at a unit distance, which chooses
+    // the mip levels of the textures.
+    tile_columns_ = size.width_ / (2 * tan_half_fov);
+  }
+
+  // Returns whether any tile has a texture on its floor or ceiling.
+  [[nodiscard]] bool textured() const
+  {
+    return textured_;
+  }
+
+  // Calls draw(column, texel) for each column of the given row whose tile
+  // has a texture for the surface seen in that row.
+  template <class Draw>
+  void cast_row(int row, Draw &&draw)
+  {
+    auto const distance = rows_.distances[row];
+
+    if (!textured_ || distance == 0)
+    {
+      return;
+    }
+
+    auto const ceiling = row < grid_.height_ / 2;
+    auto const darkness = ceiling ? ceiling_darkness(row, grid_)
+                                  : floor_darkness(row, grid_);
+    auto const projected_tile = tile_columns_ / distance;
+    auto const step = column_step_ * distance;
+    auto point = position_ + first_ray_ * distance;
+
+    textray::texture const *last_surface = nullptr;
+    std::size_t level = 0;
+    std::vector<std::size_t> const *shade_rows = nullptr;
+
+    for (int column = 0; column < grid_.width_; ++column, point += step)
+    {
+      if (point.x < 0 || point.y < 0)
+      {
+        continue;
+      }
+
+      auto const map_x = static_cast<std::size_t>(point.x);
+      auto const map_y = static_cast<std::size_t>(point.y);
+
+      if (map_y >= plan_.size() || map_x >= plan_[map_y].size())
+      {
+        continue;
+      }
+
+      auto const &tile = plan_[map_y][map_x];
+      auto const *surface =
+          (ceiling ? tile.ceiling_surface : tile.floor_surface).get();
+
+      if (surface == nullptr)
+      {
+        continue;
+      }
+
+      if (surface != last_surface)
+      {
+        last_surface = surface;
+        level = surface->level_for(projected_tile);
+        shade_rows = &palette_rows_(*surface);
+      }
+
+      auto const height = surface->height(level);
+      auto const *texels = surface->column(level, point.x - map_x);
+      auto const &texel = texels[std::min(
+          static_cast<int>((point.y - map_y) * height), height - 1)];
+
+      draw(
+          column,
+          terminalpp::element{
+              texel.glyph,
+              shades_.shade((*shade_rows)[texel.colour], darkness)});
+    }
+  }
+
+ private:
+  surface_rows const &rows_;
+  terminalpp::extent grid_;
+  textray::floorplan const &plan_;
+  textray::shade_table const &shades_;
+  palette_shade_rows palette_rows_;
+  textray::vector2d position_;
+  textray::vector2d first_ray_;
+  textray::vector2d column_step_;
+  double tile_columns_{0};
+  bool textured_{false};
+};
+
+void render_ceiling(
+    std::vector<terminalpp::string> &content,
+    terminalpp::extent size,
+    textray::shade_table const &shades,
+    surface_casting &surfaces)
+{
+  TEXTRAY_TRACE_SPAN("render_ceiling");
+
+  using namespace terminalpp::literals;  // NOLINT
+  static auto const ceiling_glyph = R"(\U28FF)"_ete.glyph_;
+  auto const shade_row = shades.row_of(ceiling_colour);
+
+  auto const max_ceiling_row = size.height_ / 2;
+
+  for (int row = 0; row < max_ceiling_row; ++row)
+  {
+    auto const &col = shades.shade(shade_row, ceiling_darkness(row, size));
+
+    auto &line = content.emplace_back(
+        size.width_, terminalpp::element{ceiling_glyph, col});
+    surfaces.cast_row(
+        row,
+        [&line](int column, terminalpp::element const &texel)
+        { line[column] = texel; });
+  }
+}
+
+void render_floor(
+    std::vector<terminalpp::string> &content,
+    terminalpp::extent size,
+    textray::shade_table const &shades,
+    surface_casting &surfaces)
+{
+  TEXTRAY_TRACE_SPAN("render_floor");
+
+  using namespace terminalpp::literals;  // NOLINT
+  static auto const floor_glyph = R"(\U28FF)"_ete.glyph_;
+  auto const shade_row = shades.row_of(floor_colour);
+
+  auto const min_floor_row = size.height_ / 2;
+
+  for (int row = min_floor_row; row < size.height_; ++row)
+  {
+    auto const &col = shades.shade(shade_row, floor_darkness(row, size));
+
+    auto &line = content.emplace_back(
+        size.width_, terminalpp::element{floor_glyph, col});
+    surfaces.cast_row(
+        row,
+        [&line](int column, terminalpp::element const &texel)
+        { line[column] = texel; });
+  }
+}
+
+// The wall first hit by a ray cast from the camera, measured in the
+// scalar type with which the ray was cast.
+template <class Scalar>
+struct basic_ray_hit
+{
+  textray::tile const *wall;
+  int map_x;             // the position of the wall on the floorplan
+  int map_y;
+  Scalar distance;       // along the ray
+  Scalar perp_distance;  // projected onto the camera's heading
+  int side;              // 0 if the wall was crossed in x, 1 if in y
+  textray::wall_face face;
+  Scalar wall_x;         // across the face, from 0 to 1
+};
+
+using ray_hit = basic_ray_hit<double>;
+
+template <class Scalar>
+ray_hit to_double(basic_ray_hit<Scalar> const &hit)
+{
+  return {
+      hit.wall,
+      hit.map_x,
+      hit.map_y,
+      static_cast<double>(hit.distance),
+      static_cast<double>(hit.perp_distance),
+      hit.side,
+      hit.face,
+      static_cast<double>(hit.wall_x)};
+}
+
+// The most walls that a single ray may find, each seen over the tops of
+// those in front of it, which bounds the cost of each ray.
+constexpr int max_wall_layers = 4;
+
+// The walls hit by a ray that may be seen, from the nearest to the
+// farthest.  They are held in place, so that casting a ray never
+// allocates.
+template <class Scalar>
+struct basic_ray_hits
+{
+  std::array<basic_ray_hit<Scalar>, max_wall_layers> layers;
+  int count{0};
+};
+
+using ray_hits = basic_ray_hits<double>;
+
+template <class Scalar>
+ray_hits to_double(basic_ray_hits<Scalar> const &hits)
+{
+  ray_hits result;
+  result.count = hits.count;
+
+  for (int layer = 0; layer < hits.count; ++layer)
+  {
+    result.layers[layer] = to_double(hits.layers[layer]);
+  }
+
+  return result;
+}
+
+// The limits within which a ray looks for walls beyond the first that it
+// hits.  The elevation of a point is its height above the eye, which is
+// halfway up a wall of the standard height, divided by its distance, and
+// so is proportional to the number of rows above the horizon at which it
+// is seen.
+template <class Scalar>
+struct basic_occlusion_limits
+{
+  double tallest;       // the height of the tallest wall
+  Scalar tallest_rise;  // the most by which any wall rises above the eye
+  Scalar view_top;      // the elevation of the top of the view
+};
+
+// The elevation of the top of a view that has no top, such as that of a
+// panorama, which is used for every view.
+constexpr double unbounded_elevation = 1000;
+
+template <class Scalar>
+basic_occlusion_limits<Scalar> make_occlusion_limits(
+    double tallest, double view_top)
+{
+  return {
+      tallest,
+      Scalar(std::max(tallest - wall_height / 2, 0.0)),
+      Scalar(view_top)};
+}
+
+// Returns where a ray hit the face of a wall, from 0 at the left of the
+// face to 1 at its right, as seen from the side from which it was hit.
+template <class Scalar>
+Scalar face_coordinate(
+    textray::basic_vector2d<Scalar> const &position,
+    textray::basic_vector2d<Scalar> const &ray,
+    Scalar wall_dist,
+    int side)
+{
+  auto const along = side == 0 ? position.y + wall_dist * ray.y
+                               : position.x + wall_dist * ray.x;
+  auto const offset = along - Scalar(static_cast<int>(along));
+  auto const mirrored = side == 0 ? ray.x > Scalar(0) : ray.y < Scalar(0);
+
+  return mirrored ? Scalar(1) - offset : offset;
+}
+
+// Returns the direction of the ray that passes through the centre of the
+// given column of the view.
+textray::vector2d ray_direction(
+    textray::vector2d const &dir,
+    textray::vector2d const &right,
+    double tan_half_fov,
+    int column,
+    int view_width)
+{
+  // x-coordinate in camera space (range [-1,+1])
+  double const camera_x = 2 * (column + 0.5) / view_width - 1;
+  return normalize(dir / tan_half_fov + right * camera_x);
+}
+
+// Returns whether a ray that has just passed through one see-through wall
+// is still within the same pane, rather than meeting another.
+bool same_pane(textray::tile const *pane, textray::tile const &wall)
+{
+  return pane != nullptr && wall.see_through
+         && pane->fill.glyph_.character_ == wall.fill.glyph_.character_
+         && pane->surface == wall.surface && pane->height == wall.height;
+}
+
+// The ray casting kernel, which is instantiated for each scalar type in
+// which rays may be cast.  The ray continues past walls over which others
+// may be seen, and through see-through walls, until the opaque walls that
+// it has hit cover the column of the view, or nothing beyond them could
+// rise above them.
+template <class Scalar>
+basic_ray_hits<Scalar> cast_ray(
+    textray::floorplan const &plan,
+    textray::basic_vector2d<Scalar> const &position,
+    textray::basic_vector2d<Scalar> const &dir,
+    textray::basic_vector2d<Scalar> const &ray,
+    basic_occlusion_limits<Scalar> const &limits)
+{
+  using std::abs;
+
+  auto map_x = static_cast<int>(position.x);
+  auto map_y = static_cast<int>(position.y);
+
+  // length of ray from current position to next x or y-side
+  Scalar side_dist_x;
+  Scalar side_dist_y;
+
+  // length of ray from one x or y-side to next x or y-side
+  Scalar delta_dist_x = abs(Scalar(1) / ray.x);
+  Scalar delta_dist_y = abs(Scalar(1) / ray.y);
+
+  // what direction to step in x or y-direction (either +1 or -1)
+  int step_x;
+  int step_y;
+
+  // calculate step and initial sideDist
+  if (ray.x < Scalar(0))
+  {
+    step_x = -1;
+    side_dist_x = (position.x - Scalar(map_x)) * delta_dist_x;
+  }
+  else
+  {
+    step_x = 1;
+    side_dist_x = (Scalar(map_x + 1) - position.x) * delta_dist_x;
+  }
+  if (ray.y < Scalar(0))
+  {
+    step_y = -1;
+    side_dist_y = (position.y - Scalar(map_y)) * delta_dist_y;
+  }
+  else
+  {
+    step_y = 1;
+    side_dist_y = (Scalar(map_y + 1) - position.y) * delta_dist_y;
+  }
+
+  basic_ray_hits<Scalar> hits;
+
+  // The elevation up to which the column is covered by the opaque walls
+  // hit so far.  Nothing below the bottom of the view can be seen.
+  auto covered = -limits.view_top;
+
+  // The see-through wall that the ray is passing through, if any.  A pane
+  // that is several tiles thick is seen only once.
+  textray::tile const *pane = nullptr;
+
+  // perform DDA (Digital Differential Analysis)
+  for (;;)
+  {
+    Scalar wall_dist;
+    int side;
+
+    // jump to next map square, OR in x-direction, OR in y-direction
+    if (side_dist_x < side_dist_y)
+    {
+      wall_dist = side_dist_x;
+      side_dist_x += delta_dist_x;
+      map_x += step_x;
+      side = 0;
+    }
+    else
+    {
+      wall_dist = side_dist_y;
+      side_dist_y += delta_dist_y;
+      map_y += step_y;
+      side = 1;
+    }
+
+    // Nothing lies beyond the edges of the floorplan.
+    if (map_y < 0 || map_x < 0 || map_y >= static_cast<int>(plan.size())
+        || map_x >= static_cast<int>(plan[map_y].size()))
+    {
+      break;
+    }
+
+    // Check if ray has hit a wall
+    //  TODO: fix when fill is more than a character code.
+    auto const &wall = plan[map_y][map_x];
+
+    if (wall.fill.glyph_.character_ == 0)
+    {
+      pane = nullptr;
+      continue;
+    }
+
+    if (same_pane(pane, wall))
+    {
+      continue;
+    }
+
+    // Calculate distance projected on camera direction (direct distance
+    // along ray will give fisheye effect!)
+    auto const perp_distance = dot(wall_dist * ray, dir);
+
+    // A wall that the camera is touching covers the whole column.
+    auto const top =
+        perp_distance > Scalar(0.001)
+            ? (Scalar(wall.height) - Scalar(wall_height / 2)) / perp_distance
+            : limits.view_top;
+
+    if (top > covered)
+    {
+      auto const face = side == 0
+                            ? (step_x > 0 ? textray::wall_face::west
+                                          : textray::wall_face::east)
+                            : (step_y > 0 ? textray::wall_face::north
+                                          : textray::wall_face::south);
+
+      hits.layers[hits.count++] = {
+          &wall,
+          map_x,
+          map_y,
+          wall_dist,
+          perp_distance,
+          side,
+          face,
+          face_coordinate(position, ray, wall_dist, side)};
+
+      if (!wall.see_through)
+      {
+        covered = top;
+      }
+    }
+
+    // Every wall beyond this one is further away, and so rises less far
+    // above the eye than the tallest wall would here.  Only an opaque wall
+    // can hide everything beyond it.
+    if (hits.count == max_wall_layers || covered >= limits.view_top
+        || (!wall.see_through && wall.height >= limits.tallest)
+        || covered * perp_distance >= limits.tallest_rise)
+    {
+      break;
+    }
+
+    pane = wall.see_through ? &wall : nullptr;
+  }
+
+  return hits;
+}
+
+// The shade of a wall depends only on its distance and on the percentage
+// of darkness that static lights remove from it, and so is looked up once
+// for each ray.  The shader is instantiated for each colour depth, so that
+// whatever depends on the depth is decided at compile time rather than for
+// each ray.
+template <textray::colour_depth Depth>
+terminalpp::attribute shade_wall(
+    textray::shade_table const &shades,
+    std::size_t shade_row,
+    ray_hit const &hit,
+    int light)
+{
+  auto const darkest_distance = 7;
+  auto const percentage_factor = 100 / darkest_distance;
+  auto const distance =
+      std::min(hit.distance, static_cast<double>(darkest_distance));
+  auto const darkness_percentage = distance * percentage_factor;
+
+  auto darkened_colour = shades.shade(
+      shade_row, std::max(lerp0(90, darkness_percentage) - light, 0.0));
+
+  // Bright colours in the 16-colour palette are selected with bold
+  // intensity, and so must not be overridden here.  No other depth selects
+  // its colours by intensity.
+  if constexpr (Depth == textray::colour_depth::low_colour)
+  {
+    if (darkened_colour.intensity_ != terminalpp::graphics::intensity::normal)
+    {
+      return darkened_colour;
+    }
+  }
+
+  if (hit.perp_distance < 1.0)
+  {
+    darkened_colour.intensity_ = terminalpp::graphics::intensity::bold;
+  }
+  else if (hit.perp_distance > 2.5)
+  {
+    darkened_colour.intensity_ = terminalpp::graphics::intensity::faint;
+  }
+
+  return darkened_colour;
+}
+
+using wall_shader = terminalpp::attribute (*)(
+    textray::shade_table const &shades,
+    std::size_t shade_row,
+    ray_hit const &hit,
+    int light);
+
+wall_shader select_wall_shader(textray::colour_depth depth)
+{
+  switch (depth)
+  {
+    case textray::colour_depth::high_colour:
+      return shade_wall<textray::colour_depth::high_colour>;
+
+    case textray::colour_depth::low_colour:
+      return shade_wall<textray::colour_depth::low_colour>;
+
+    case textray::colour_depth::greyscale:
+      return shade_wall<textray::colour_depth::greyscale>;
+
+    default:
+      return shade_wall<textray::colour_depth::true_colour>;
+  }
+}
+
+// The span of a wall seen by one column of rays, in rows of cells, and
+// its shade.  The span excludes the rows in which the wall is hidden by
+// opaque walls in front of it.
+//
+// A textured wall is instead drawn from a column of texels, which have
+// already been shaded, stretched over the rows of the whole wall, even
+// those that lie outside the view.
+struct wall_span
+{
+  double top{0};
+  double bottom{0};
+  terminalpp::attribute attribute;
+
+  double wall_top{0};
+  double wall_rows{0};
+  std::size_t first_texel{0};
+  int texel_count{0};  // 0 for a wall of a flat colour
+
+  bool see_through{false};
+};
+
+// The spans of the walls seen by one column of rays, from the nearest to
+// the farthest.  Since each wall is seen only above the opaque walls in
+// front of it, only the spans of see-through walls overlap others.
+struct wall_column
+{
+  std::array<wall_span, max_wall_layers> layers;
+  int count{0};
+};
+
+// The walls seen by each column of a view, and the shaded texels from
+// which the textured spans among them are drawn.
+struct wall_pass
+{
+  std::vector<wall_column> columns;
+  std::vector<terminalpp::element> texels;
+};
+
+// Returns the texel of a textured span that is drawn at the given
+// position down the view, in rows.
+terminalpp::element const &texel_at(
+    wall_pass const &pass, wall_span const &span, double row)
+{
+  auto const texels_per_row = span.texel_count / span.wall_rows;
+  auto const index = std::clamp(
+      static_cast<int>((row - span.wall_top) * texels_per_row),
+      0,
+      span.texel_count - 1);
+
+  return pass.texels[span.first_texel + index];
+}
+
+// Shades the walls of a single pass of rays.  The shader for the depth of
+// the shade table is chosen once for the pass, and the shade row of each
+// wall's colour is found the first time that the pass meets it, which
+// saves comparing colours for every ray.  Walls are lit from the lightmap,
+// if there is one.
+class wall_shading
+{
+ public:
+  wall_shading(
+      textray::shade_table const &shades, textray::lightmap const *lighting)
+    : shades_(shades),
+      lighting_(lighting),
+      shader_(select_wall_shader(shades.depth())),
+      palette_rows_(shades)
+  {
+    shade_rows_.fill(no_row);
+  }
+
+  terminalpp::attribute operator()(ray_hit const &hit)
+  {
+    auto &shade_row = shade_rows_[hit.wall->fill.glyph_.character_];
+
+    if (shade_row == no_row)
+    {
+      shade_row = shades_.row_of(wall_colour(*hit.wall));
+    }
+
+    return shader_(shades_, shade_row, hit, light_on(hit));
+  }
+
+  // Shades the column of a wall's texture that a ray hit, at the mip level
+  // that best matches the height of its span, and appends it to the
+  // texels of the pass.
+  void shade_texture(
+      wall_span &span,
+      ray_hit const &hit,
+      int texel_rows_per_cell,
+      std::vector<terminalpp::element> &texels)
+  {
+    auto const &surface = *hit.wall->surface;
+    auto const level = surface.level_for(span.wall_rows * texel_rows_per_cell);
+    auto const *column = surface.column(level, hit.wall_x);
+    auto const &shade_rows = palette_rows_(surface);
+    auto const light = light_on(hit);
+
+    span.first_texel = texels.size();
+    span.texel_count = surface.height(level);
+
+    for (int index = 0; index < span.texel_count; ++index)
+    {
+      texels.emplace_back(
+          column[index].glyph,
+          shader_(shades_, shade_rows[column[index].colour], hit, light));
+    }
+  }
+
+ private:
+  static constexpr std::size_t no_row = ~std::size_t{0};
+
+  int light_on(ray_hit const &hit) const
+  {
+    return lighting_ == nullptr ? 0
+                                : lighting_->luxel(
+                                    hit.map_x, hit.map_y, hit.face, hit.wall_x);
+  }
+
+  textray::shade_table const &shades_;
+  textray::lightmap const *lighting_;
+  wall_shader shader_;
+
+  // The colour of a wall is encoded in the character of its fill, and so
+  // its shade row is indexed by that character.
+  std::array<std::size_t, 256> shade_rows_;
+
+  palette_shade_rows palette_rows_;
+};
+
+// Returns whether two rays hit the same face of the same wall.  Since
+// walls are whole cells of the floorplan, and so are at least as wide as
+// the part of any one face that lies between two such rays, anything that
+// stood in front of that face between the rays would have been hit by one
+// of them.  Every ray between them must therefore hit the same face.
+template <class Scalar>
+bool same_face(
+    basic_ray_hit<Scalar> const &lhs, basic_ray_hit<Scalar> const &rhs)
+{
+  return lhs.wall == rhs.wall && lhs.side == rhs.side;
+}
+
+// Returns whether two rays hit the same faces of the same walls, after
+// which every ray between them must stop.  That is certain only if the
+// last wall is opaque and as tall as any, so that nothing could be seen
+// over or through it.  Rays that merely ran out of layers may still part
+// between them, to see a taller wall past a gap in the shorter ones.
+template <class Scalar>
+bool same_faces(
+    basic_ray_hits<Scalar> const &lhs,
+    basic_ray_hits<Scalar> const &rhs,
+    double tallest)
+{
+  if (lhs.count == 0 || lhs.count != rhs.count)
+  {
+    return false;
+  }
+
+  for (int layer = 0; layer < lhs.count; ++layer)
+  {
+    if (!same_face(lhs.layers[layer], rhs.layers[layer]))
+    {
+      return false;
+    }
+  }
+
+  auto const &last = *lhs.layers[lhs.count - 1].wall;
+
+  return !last.see_through && last.height >= tallest;
+}
+
+// Returns the distance along a ray, in one axis, from a position to a grid
+// line of the floorplan.  This is accumulated exactly as cast_ray
+// accumulates it, so that the distance is identical to that found by
+// casting the ray.
+template <class Scalar>
+Scalar distance_to_grid_line(Scalar position, Scalar ray, int grid_line)
+{
+  using std::abs;
+
+  auto const cell = static_cast<int>(position);
+  Scalar const delta_dist = abs(Scalar(1) / ray);
+  auto const step = ray < Scalar(0) ? -1 : 1;
+  auto boundary = ray < Scalar(0) ? cell : cell + 1;
+  Scalar distance = ray < Scalar(0)
+                        ? (position - Scalar(cell)) * delta_dist
+                        : (Scalar(cell + 1) - position) * delta_dist;
+
+  for (; (grid_line - boundary) * step > 0; boundary += step)
+  {
+    distance += delta_dist;
+  }
+
+  return distance;
+}
+
+// Returns where a ray hits the face of a wall that is known to lie in its
+// path, given another ray that hit the same face.  The face lies on a grid
+// line, which is found by rounding the point at which the other ray hit.
+template <class Scalar>
+basic_ray_hit<Scalar> hit_face(
+    basic_ray_hit<Scalar> const &known,
+    textray::basic_vector2d<Scalar> const &known_ray,
+    textray::basic_vector2d<Scalar> const &position,
+    textray::basic_vector2d<Scalar> const &dir,
+    textray::basic_vector2d<Scalar> const &ray)
+{
+  auto const known_point = position + known.distance * known_ray;
+  auto const face = known.side == 0 ? known_point.x : known_point.y;
+  auto const grid_line =
+      static_cast<int>(std::lround(static_cast<double>(face)));
+
+  Scalar const wall_dist =
+      known.side == 0 ? distance_to_grid_line(position.x, ray.x, grid_line)
+                      : distance_to_grid_line(position.y, ray.y, grid_line);
+
+  return {
+      known.wall,
+      known.map_x,
+      known.map_y,
+      wall_dist,
+      dot(wall_dist * ray, dir),
+      known.side,
+      known.face,
+      face_coordinate(position, ray, wall_dist, known.side)};
+}
+
+// Returns where a ray hits each of the faces hit by another ray, all of
+// which are known to lie in its path.
+template <class Scalar>
+basic_ray_hits<Scalar> hit_faces(
+    basic_ray_hits<Scalar> const &known,
+    textray::basic_vector2d<Scalar> const &known_ray,
+    textray::basic_vector2d<Scalar> const &position,
+    textray::basic_vector2d<Scalar> const &dir,
+    textray::basic_vector2d<Scalar> const &ray)
+{
+  basic_ray_hits<Scalar> hits;
+  hits.count = known.count;
+
+  for (int layer = 0; layer < known.count; ++layer)
+  {
+    hits.layers[layer] =
+        hit_face(known.layers[layer], known_ray, position, dir, ray);
+  }
+
+  return hits;
+}
+
+// Returns the span of the wall that a ray hit, as seen in a view of the
+// given size above the given row, beneath which it is hidden by walls in
+// front of it.  The wall is projected in the scalar type of the ray, and
+// converted to double only once its span is known.
+template <class Scalar>
+wall_span make_wall_span(
+    basic_ray_hit<Scalar> const &hit,
+    terminalpp::extent size,
+    Scalar fov_scale_y,
+    double open_bottom,
+    wall_shading &shading)
+{
+  wall_span span;
+
+  if (hit.perp_distance > Scalar(0.001))
+  {
+    auto const view_height = Scalar(size.height_);
+
+    // Calculate height of line to draw on screen.
+    // Correct for the textel aspect ratio to make sure the height is correct
+    // on the screen.
+    auto line_height = view_height * Scalar(wall_height) / hit.perp_distance
+                       / fov_scale_y / Scalar(textel_aspect);
+
+    // Calculate lowest and highest textel to fill in current stripe.  A
+    // wall stands on the floor, and so only its top moves with its height.
+    auto const half_view_height = view_height / Scalar(2);
+    auto const half_line_height = line_height / Scalar(2);
+    auto const wall_top = half_view_height - half_line_height
+                          - line_height * Scalar(hit.wall->height - 1);
+
+    span.top = static_cast<double>(std::max(wall_top, Scalar(0)));
+    span.bottom = std::min(
+        static_cast<double>(
+            std::min(half_view_height + half_line_height, view_height)),
+        open_bottom);
+
+    if (span.bottom <= span.top)
+    {
+      return wall_span{};
+    }
+
+    span.attribute = shading(to_double(hit));
+    span.see_through = hit.wall->see_through;
+    span.wall_top = static_cast<double>(wall_top);
+    span.wall_rows =
+        static_cast<double>(line_height * Scalar(hit.wall->height));
+  }
+
+  return span;
+}
+
+// Finds the spans of the walls that a ray hit, from the nearest, shading
+// the texels of the textures of those that are seen into the pass.
+template <class Scalar>
+void add_wall_spans(
+    wall_pass &pass,
+    int column,
+    basic_ray_hits<Scalar> const &hits,
+    terminalpp::extent size,
+    Scalar fov_scale_y,
+    int texel_rows_per_cell,
+    wall_shading &shading)
+{
+  auto &walls = pass.columns[column];
+
+  // Each opaque wall hides the rows beneath its top from the walls behind
+  // it.
+  auto open_bottom = static_cast<double>(size.height_);
+
+  for (int layer = 0; layer < hits.count; ++layer)
+  {
+    auto const &hit = hits.layers[layer];
+    auto span = make_wall_span(hit, size, fov_scale_y, open_bottom, shading);
+
+    if (span.bottom <= span.top)
+    {
+      continue;
+    }
+
+    if (hit.wall->surface)
+    {
+      shading.shade_texture(
+          span, to_double(hit), texel_rows_per_cell, pass.texels);
+    }
+
+    if (!span.see_through)
+    {
+      open_bottom = span.top;
+    }
+
+    walls.layers[walls.count++] = span;
+  }
+}
+
+// The ray pass that is shared by every render mode: finds the span of the
+// wall seen through each of the given number of columns across the view.
+// The directions of the rays are found in double precision, and then cast
+// in the given scalar type.
+//
+// With a column stride greater than 1, only every stride-th column is cast
+// at first.  Between two cast columns that hit the same face of a wall,
+// the columns in between are found to hit that face directly, without
+// casting.  Otherwise, the column midway between them is cast, and each
+// half is refined in the same way.
+template <class Scalar>
+wall_pass cast_walls(
+    terminalpp::extent size,
+    int columns,
+    int texel_rows_per_cell,
+    textray::floorplan const &plan,
+    textray::shade_table const &shades,
+    textray::vector2d const &position,
+    double heading,
+    double fov,
+    textray::render_options const &options)
+{
+  TEXTRAY_TRACE_SPAN("cast_walls");
+
+  wall_pass pass;
+  pass.columns.resize(std::max(columns, 0));
+
+  if (size.width_ <= 0 || size.height_ <= 0)
+  {
+    return pass;
+  }
+
+  // identify components of a unit vector in the direction of the camera
+  // heading and a plane perpendicular to it on which the textels(!) are
+  // rendered.
+  auto const dir = textray::vector2d::from_angle(heading);
+  auto const right = textray::vector2d::from_angle(heading - M_PI / 2);
+
+  double const tan_half_fov = tan(fov / 2);
+  auto const fov_scale_y = static_cast<Scalar>(vertical_fov_scale(size, fov));
+  auto const origin = textray::vector_cast<Scalar>(position);
+  auto const heading_dir = textray::vector_cast<Scalar>(dir);
+  auto const column_stride = options.column_stride;
+  wall_shading shading(shades, options.lighting);
+
+  // The top of the view lies as far above the horizon as the top of a wall
+  // of the standard height at a distance of 1 / (fov_scale_y * aspect).
+  auto const limits = make_occlusion_limits<Scalar>(
+      options.summary->tallest_wall,
+      vertical_fov_scale(size, fov) * textel_aspect * wall_height / 2);
+
+  std::vector<textray::basic_vector2d<Scalar>> rays(columns);
+  std::vector<basic_ray_hits<Scalar>> hits(columns);
+
+  for (int x = 0; x < columns; ++x)
+  {
+    rays[x] = textray::vector_cast<Scalar>(
+        ray_direction(dir, right, tan_half_fov, x, columns));
+  }
+
+  auto const cast_column = [&](int x)
+  { hits[x] = cast_ray(plan, origin, heading_dir, rays[x], limits); };
+
+  // Finds the hits of the columns strictly between two that have been
+  // cast.
+  auto const refine = [&](int first, int last, auto const &self) -> void
+  {
+    if (last - first <= 1)
+    {
+      return;
+    }
+
+    if (same_faces(hits[first], hits[last], limits.tallest))
+    {
+      for (int x = first + 1; x < last; ++x)
+      {
+        hits[x] = hit_faces(
+            hits[first], rays[first], origin, heading_dir, rays[x]);
+      }
+
+      return;
+    }
+
+    auto const middle = first + (last - first) / 2;
+    cast_column(middle);
+    self(first, middle, self);
+    self(middle, last, self);
+  };
+
+  if (column_stride <= 1)
+  {
+    for (int x = 0; x < columns; ++x)
+    {
+      cast_column(x);
+    }
+  }
+  else if (columns > 0)
+  {
+    auto previous = 0;
+    cast_column(previous);
+
+    while (previous != columns - 1)
+    {
+      auto const next = std::min(previous + column_stride, columns - 1);
+      cast_column(next);
+      refine(previous, next, refine);
+      previous = next;
+    }
+  }
+
+  for (int x = 0; x < columns; ++x)
+  {
+    add_wall_spans(
+        pass, x, hits[x], size, fov_scale_y, texel_rows_per_cell, shading);
+  }
+
+  return pass;
+}
+
+wall_pass cast_walls(
+    terminalpp::extent size,
+    int columns,
+    int texel_rows_per_cell,
+    textray::floorplan const &plan,
+    textray::shade_table const &shades,
+    textray::vector2d const &position,
+    double heading,
+    double fov,
+    textray::render_options const &options)
+{
+  auto const rows = texel_rows_per_cell;
+
+  switch (options.precision)
+  {
+    case textray::render_precision::single_precision:
+      return cast_walls<float>(
+          size, columns, rows, plan, shades, position, heading, fov, options);
+
+    case textray::render_precision::fixed_point:
+      return cast_walls<textray::fixed16_16>(
+          size, columns, rows, plan, shades, position, heading, fov, options);
+
+    default:
+      return cast_walls<double>(
+          size, columns, rows, plan, shades, position, heading, fov, options);
+  }
+}
+
+// Casts a single ray in the given precision, for a view without a top,
+// over walls of which the given height is the tallest.
+ray_hits cast_ray(
+    textray::floorplan const &plan,
+    textray::vector2d const &position,
+    textray::vector2d const &ray,
+    textray::render_precision precision,
+    double tallest)
+{
+  using textray::vector_cast;
+
+  switch (precision)
+  {
+    case textray::render_precision::single_precision:
+      return to_double(cast_ray(
+          plan,
+          vector_cast<float>(position),
+          vector_cast<float>(ray),
+          vector_cast<float>(ray),
+          make_occlusion_limits<float>(tallest, unbounded_elevation)));
+
+    case textray::render_precision::fixed_point:
+      return to_double(cast_ray(
+          plan,
+          vector_cast<textray::fixed16_16>(position),
+          vector_cast<textray::fixed16_16>(ray),
+          vector_cast<textray::fixed16_16>(ray),
+          make_occlusion_limits<textray::fixed16_16>(
+              tallest, unbounded_elevation)));
+
+    default:
+      return cast_ray(
+          plan,
+          position,
+          ray,
+          ray,
+          make_occlusion_limits<double>(tallest, unbounded_elevation));
+  }
+}
+
+// Casts the walls seen by the given number of columns across the view,
+// choosing the mip level of each textured wall for the given number of
+// texels that are drawn for each row of cells.  This allows each render
+// mode to choose its resolution, while the rays themselves are cast either
+// directly or from a panorama.
+using wall_caster =
+    std::function<wall_pass(int columns, int texel_rows_per_cell)>;
+
+// Returns the span of a wall in rows of sub-cells, each cell being divided
+// into the given number of sub-cells, rounded to the nearest sub-cell.
+std::pair<int, int> sub_cell_span(wall_span const &span, int sub_cells)
+{
+  return {
+      static_cast<int>(std::lround(span.top * sub_cells)),
+      static_cast<int>(std::lround(span.bottom * sub_cells))};
+}
+
+// Draws the span of a wall into a column of cells.
+void render_wall_span(
+    std::vector<terminalpp::string> &content,
+    wall_pass const &pass,
+    wall_span const &span,
+    terminalpp::coordinate_type x)
+{
+  double const draw_start = span.top;
+  double const draw_end = span.bottom;
+
+  using namespace terminalpp::literals;  // NOLINT
+  static constexpr auto cube_glyph = R"(\U28FF)"_ete.glyph_;
+  auto const high_glyph = top_glyph(draw_start);
+  auto const low_glyph = bottom_glyph(draw_end);
+
+  if (static_cast<int>(draw_start) > 0)
+  {
+    content[static_cast<int>(draw_start) - 1][x].glyph_ =
+        top_ceiling_glyph(draw_start);
+  }
+
+  for (auto row = static_cast<terminalpp::coordinate_type>(draw_start);
+       row < static_cast<terminalpp::coordinate_type>(draw_end);
+       ++row)
+  {
+    auto const top_row = row == static_cast<int>(draw_start);
+    auto const bottom_row = row == (static_cast<int>(draw_end) - 1);
+
+    if (span.texel_count == 0)
+    {
+      content[row][x] = terminalpp::element{
+          (top_row      ? high_glyph
+           : bottom_row ? low_glyph
+                        : cube_glyph),
+          span.attribute};
+    }
+    else
+    {
+      // The partly covered cells at the ends of a textured wall keep
+      // their partial glyphs, in the colour of the texel.
+      auto const &texel = texel_at(pass, span, row + 0.5);
+
+      content[row][x] = terminalpp::element{
+          (top_row      ? high_glyph
+           : bottom_row ? low_glyph
+                        : texel.glyph_),
+          texel.attribute_};
+    }
+  }
+
+  if (static_cast<int>(draw_end) < static_cast<int>(content.size()))
+  {
+    content[static_cast<int>(draw_end)][x].glyph_ =
+        bottom_floor_glyph(draw_end);
+  }
+}
+
+// Returns whether a texel of a see-through wall is clear, and so leaves
+// whatever lies behind it untouched.
+bool is_clear(terminalpp::element const &texel)
+{
+  return texel.glyph_.character_ == ' ';
+}
+
+// Draws the span of a see-through wall over whatever has already been
+// drawn behind it in a column of cells.  Each cell that the wall tints
+// takes the glyph and colour of its texel, over a background of the
+// colour of what lies behind it.  Tinted glass is drawn as a light shade.
+void render_see_through_span(
+    std::vector<terminalpp::string> &content,
+    wall_pass const &pass,
+    wall_span const &span,
+    terminalpp::coordinate_type x)
+{
+  using namespace terminalpp::literals;  // NOLINT
+  static auto const glass_glyph = R"(\U2591)"_ete.glyph_;
+
+  auto const [top, bottom] = sub_cell_span(span, 1);
+
+  for (auto row = top; row < bottom; ++row)
+  {
+    auto const texel = span.texel_count == 0
+                           ? terminalpp::element{glass_glyph, span.attribute}
+                           : texel_at(pass, span, row + 0.5);
+
+    if (is_clear(texel))
+    {
+      continue;
+    }
+
+    auto &cell = content[row][x];
+    auto attribute = texel.attribute_;
+    attribute.background_colour_ = cell.attribute_.foreground_colour_;
+    cell = terminalpp::element{texel.glyph_, attribute};
+  }
+}
+
+void render_walls(
+    std::vector<terminalpp::string> &content, wall_caster const &cast)
+{
+  TEXTRAY_TRACE_SPAN("render_walls");
+
+  auto const view_height = static_cast<int>(content.size());
+  if (view_height == 0)
+  {
+    return;
+  }
+
+  auto const view_width = static_cast<int>(content[0].size());
+  if (view_width == 0)
+  {
+    return;
+  }
+
+  auto const pass = cast(view_width, 1);
+
+  for (terminalpp::coordinate_type x = 0; x < view_width; ++x)
+  {
+    auto const &walls = pass.columns[x];
+
+    // The walls are drawn from the farthest, so that the partly covered
+    // cells at the top of each wall are drawn over the wall behind it, and
+    // each see-through wall over whatever is seen through it.
+    for (auto layer = walls.count - 1; layer >= 0; --layer)
+    {
+      auto const &span = walls.layers[layer];
+
+      if (span.see_through)
+      {
+        render_see_through_span(content, pass, span, x);
+      }
+      else
+      {
+        render_wall_span(content, pass, span, x);
+      }
+    }
+  }
+}
+
+// Returns the colour of the ceiling or floor behind the given row of a
+// view that is the given number of rows high.
+terminalpp::colour background_colour(
+    textray::shade_table const &shades, int row, terminalpp::extent size)
+{
+  return row < size.height_ / 2
+             ? shades.shade(
+                   shades.row_of(ceiling_colour), ceiling_darkness(row, size))
+                   .foreground_colour_
+             : shades.shade(
+                   shades.row_of(floor_colour), floor_darkness(row, size))
+                   .foreground_colour_;
+}
+
+// Renders the view at twice the vertical resolution of the cells by
+// drawing the upper half of each cell as its foreground, using an upper
+// half block, and the lower half as its background.  Since each half has
+// only a colour, the intensity with which walls are shaded in the other
+// modes is not used.
+void render_half_blocks(
+    std::vector<terminalpp::string> &content,
+    terminalpp::extent size,
+    textray::shade_table const &shades,
+    surface_casting &surfaces,
+    wall_caster const &cast)
+{
+  TEXTRAY_TRACE_SPAN("render_half_blocks");
+
+  static constexpr int halves_per_cell = 2;
+
+  if (size.width_ <= 0 || size.height_ <= 0)
+  {
+    return;
+  }
+
+  auto const pass = cast(size.width_, halves_per_cell);
+
+  // The ceiling and floor are shaded for each half row, which gives them
+  // a smoother gradient than in the other modes.
+  auto const half_rows = terminalpp::extent{
+      size.width_, static_cast<terminalpp::coordinate_type>(
+                       size.height_ * halves_per_cell)};
+  std::vector<terminalpp::colour> backgrounds(half_rows.height_);
+
+  for (int half_row = 0; half_row < half_rows.height_; ++half_row)
+  {
+    backgrounds[half_row] = background_colour(shades, half_row, half_rows);
+  }
+
+  // The span of half rows covered by each wall seen in each column.
+  std::vector<std::array<std::pair<int, int>, max_wall_layers>> wall_halves(
+      size.width_);
+
+  for (int x = 0; x < size.width_; ++x)
+  {
+    auto const &walls = pass.columns[x];
+
+    for (int layer = 0; layer < walls.count; ++layer)
+    {
+      wall_halves[x][layer] =
+          sub_cell_span(walls.layers[layer], halves_per_cell);
+    }
+  }
+
+  using namespace terminalpp::literals;  // NOLINT
+  static constexpr auto upper_half_glyph = R"(\U2580)"_ete.glyph_;
+
+  // The colours of the ceiling or floor behind each half of the current
+  // row of cells, which are textured where their tiles have a texture.
+  std::vector<terminalpp::colour> upper_surface(size.width_);
+  std::vector<terminalpp::colour> lower_surface(size.width_);
+
+  auto const cast_surface =
+      [&surfaces](int half_row, std::vector<terminalpp::colour> &colours)
+  {
+    surfaces.cast_row(
+        half_row,
+        [&colours](int column, terminalpp::element const &texel)
+        { colours[column] = texel.attribute_.foreground_colour_; });
+  };
+
+  for (int row = 0; row < size.height_; ++row)
+  {
+    auto const upper = row * halves_per_cell;
+    auto const lower = upper + 1;
+    auto &line = content.emplace_back(size.width_, terminalpp::element{});
+
+    std::fill(upper_surface.begin(), upper_surface.end(), backgrounds[upper]);
+    std::fill(lower_surface.begin(), lower_surface.end(), backgrounds[lower]);
+    cast_surface(upper, upper_surface);
+    cast_surface(lower, lower_surface);
+
+    for (int x = 0; x < size.width_; ++x)
+    {
+      auto const &walls = pass.columns[x];
+
+      // Each half takes the colour of the nearest wall that covers it, if
+      // any, and each half of a textured wall the colour of its own texel.
+      // The walls are composited from the nearest, until one is opaque: a
+      // see-through wall shows only where its texels are not clear, and
+      // tinted glass only on every other half, through which what lies
+      // behind it shows.
+      auto const colour_of =
+          [&](int half, terminalpp::colour const &surface)
+          -> terminalpp::colour const &
+      {
+        for (int layer = 0; layer < walls.count; ++layer)
+        {
+          auto const [top, bottom] = wall_halves[x][layer];
+
+          if (half < top || half >= bottom)
+          {
+            continue;
+          }
+
+          auto const &span = walls.layers[layer];
+
+          if (span.texel_count == 0)
+          {
+            if (!span.see_through || (x + half) % 2 == 0)
+            {
+              return span.attribute.foreground_colour_;
+            }
+
+            continue;
+          }
+
+          auto const &texel =
+              texel_at(pass, span, (half + 0.5) / halves_per_cell);
+
+          if (!span.see_through || !is_clear(texel))
+          {
+            return texel.attribute_.foreground_colour_;
+          }
+        }
+
+        return surface;
+      };
+
+      terminalpp::attribute attr;
+      attr.foreground_colour_ = colour_of(upper, upper_surface[x]);
+      attr.background_colour_ = colour_of(lower, lower_surface[x]);
+
+      line[x] = terminalpp::element{upper_half_glyph, attr};
+    }
+  }
+}
+
+// The braille dots of a cell are numbered down its left column and then
+// down its right column, except for the bottom row of dots, which were
+// added later and so take the two highest bits.  These tables map a mask
+// of the dots in a single column (bit 0 at the top) onto those bits.
+constexpr std::array<std::uint8_t, 16> make_braille_column_bits(
+    std::array<std::uint8_t, 4> const &dot_bits)
+{
+  std::array<std::uint8_t, 16> table{};
+
+  for (std::size_t mask = 0; mask < table.size(); ++mask)
+  {
+    for (std::size_t dot = 0; dot < dot_bits.size(); ++dot)
+    {
+      if ((mask & (1U << dot)) != 0)
+      {
+        table[mask] |= dot_bits[dot];
+      }
+    }
+  }
+
+  return table;
+}
+
+constexpr auto braille_left_bits =
+    make_braille_column_bits({0x01, 0x02, 0x04, 0x40});
+constexpr auto braille_right_bits =
+    make_braille_column_bits({0x08, 0x10, 0x20, 0x80});
+
+constexpr std::array<std::uint8_t, 16> dot_counts = {
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+// The glyph for every pattern of braille dots, indexed by its bits.
+std::array<terminalpp::glyph, 256> const &braille_glyphs()
+{
+  static auto const glyphs = []
+  {
+    using namespace terminalpp::literals;  // NOLINT
+    std::array<terminalpp::glyph, 256> table;
+
+    for (std::size_t pattern = 0; pattern < table.size(); ++pattern)
+    {
+      auto const text = (boost::format(R"(\U28%02X)") % pattern).str();
+      table[pattern] = operator""_ete(text.c_str(), text.size()).glyph_;
+    }
+
+    return table;
+  }();
+
+  return glyphs;
+}
+
+// Returns the mask of the four dots of a cell, starting at dot row
+// cell_top, that lie within the span [top, bottom) of a column of dots.
+constexpr std::uint8_t braille_column_mask(int top, int bottom, int cell_top)
+{
+  auto const from = std::clamp(top - cell_top, 0, 4);
+  auto const to = std::clamp(bottom - cell_top, 0, 4);
+
+  return static_cast<std::uint8_t>(((1U << to) - 1) & ~((1U << from) - 1));
+}
+
+// Renders the view at the resolution of braille dots: two columns and four
+// rows of dots per cell.  One ray is cast for each column of dots, and the
+// spans of dots covered by its walls are packed into each cell's pattern of
+// dots.  Dots that are set are drawn in the colour of the nearest wall in
+// the cell, and those that are clear in the colour of the ceiling or floor
+// behind it.
+void render_braille(
+    std::vector<terminalpp::string> &content,
+    terminalpp::extent size,
+    textray::shade_table const &shades,
+    surface_casting &surfaces,
+    wall_caster const &cast)
+{
+  TEXTRAY_TRACE_SPAN("render_braille");
+
+  static constexpr int dots_per_column = 2;
+  static constexpr int dots_per_row = 4;
+
+  if (size.width_ <= 0 || size.height_ <= 0)
+  {
+    return;
+  }
+
+  auto const dot_columns = size.width_ * dots_per_column;
+  auto const pass = cast(dot_columns, 1);
+
+  // The spans of dot rows covered by each wall seen in each column of dots.
+  using layer_rows = std::array<int, max_wall_layers>;
+  std::vector<layer_rows> wall_tops(dot_columns);
+  std::vector<layer_rows> wall_bottoms(dot_columns);
+
+  for (int column = 0; column < dot_columns; ++column)
+  {
+    auto const &walls = pass.columns[column];
+
+    for (int layer = 0; layer < walls.count; ++layer)
+    {
+      std::tie(wall_tops[column][layer], wall_bottoms[column][layer]) =
+          sub_cell_span(walls.layers[layer], dots_per_row);
+    }
+  }
+
+  // Returns the mask of the dots of the given cell row, in the given column
+  // of dots, that the given wall covers.  A see-through wall covers only
+  // those cells where its texel is not clear, and tinted glass only every
+  // other dot, through which what lies behind it shows.
+  auto const layer_mask = [&](int column, int layer, int row) -> std::uint8_t
+  {
+    auto const &span = pass.columns[column].layers[layer];
+    auto const mask = braille_column_mask(
+        wall_tops[column][layer],
+        wall_bottoms[column][layer],
+        row * dots_per_row);
+
+    if (!span.see_through || mask == 0)
+    {
+      return mask;
+    }
+
+    if (span.texel_count == 0)
+    {
+      return mask & (column % 2 == 0 ? 0b0101 : 0b1010);
+    }
+
+    return is_clear(texel_at(pass, span, row + 0.5)) ? 0 : mask;
+  };
+
+  TEXTRAY_TRACE_SPAN("render_braille pack");
+
+  auto const &glyphs = braille_glyphs();
+  std::vector<std::uint8_t> column_masks(dot_columns);
+
+  for (int row = 0; row < size.height_; ++row)
+  {
+    terminalpp::attribute background;
+    background.background_colour_ = background_colour(shades, row, size);
+
+    auto &line = content.emplace_back(
+        size.width_, terminalpp::element{glyphs[0], background});
+
+    // Only the colour of a textured ceiling or floor shows behind the
+    // dots.
+    surfaces.cast_row(
+        row,
+        [&line](int column, terminalpp::element const &texel)
+        {
+          line[column].attribute_.background_colour_ =
+              texel.attribute_.foreground_colour_;
+        });
+
+    // Masking each column is kept separate from packing the masks into
+    // cells so that the compiler is free to vectorise it.
+    for (int column = 0; column < dot_columns; ++column)
+    {
+      std::uint8_t mask = 0;
+
+      for (int layer = 0; layer < pass.columns[column].count; ++layer)
+      {
+        mask |= layer_mask(column, layer, row);
+      }
+
+      column_masks[column] = mask;
+    }
+
+    for (int x = 0; x < size.width_; ++x)
+    {
+      auto const left_mask = column_masks[x * dots_per_column];
+      auto const right_mask = column_masks[x * dots_per_column + 1];
+      auto const pattern =
+          braille_left_bits[left_mask] | braille_right_bits[right_mask];
+
+      if (pattern == 0)
+      {
+        continue;
+      }
+
+      // A cell has only one foreground colour, so it is taken from the
+      // column of dots that covers more of the cell.
+      auto const dominant_column =
+          dot_counts[left_mask] >= dot_counts[right_mask]
+              ? x * dots_per_column
+              : x * dots_per_column + 1;
+
+      // Of that column's walls, the nearest that shows in the cell is
+      // drawn.
+      auto const &walls = pass.columns[dominant_column];
+      auto layer = 0;
+
+      while (layer + 1 < walls.count
+             && layer_mask(dominant_column, layer, row) == 0)
+      {
+        ++layer;
+      }
+
+      auto const &span = walls.layers[layer];
+      auto attr = span.texel_count == 0
+                      ? span.attribute
+                      : texel_at(pass, span, row + 0.5).attribute_;
+      attr.background_colour_ = line[x].attribute_.background_colour_;
+
+      line[x] = terminalpp::element{glyphs[pattern], attr};
+    }
+  }
+}
+
+std::vector<terminalpp::string> render_view(
+    terminalpp::extent size,
+    textray::floorplan const &plan,
+    textray::shade_table const &shades,
+    textray::vector2d const &position,
+    double heading,
+    double fov,
+    textray::render_options const &options,
+    surface_rows &rows,
+    wall_caster const &cast)
+{
+  std::vector<terminalpp::string> content;
+
+  auto const surfaces_for = [&](int rows_per_cell)
+  {
+    return surface_casting(
+        update_surface_rows(rows, size, rows_per_cell, fov),
+        size,
+        rows_per_cell,
+        plan,
+        shades,
+        position,
+        heading,
+        fov,
+        options.summary->surfaces_textured);
+  };
+
+  switch (options.mode)
+  {
+    case textray::render_mode::half_blocks:
+    {
+      auto surfaces = surfaces_for(2);
+      render_half_blocks(content, size, shades, surfaces, cast);
+      break;
+    }
+
+    case textray::render_mode::braille:
+    {
+      auto surfaces = surfaces_for(1);
+      render_braille(content, size, shades, surfaces, cast);
+      break;
+    }
+
+    default:
+    {
+      auto surfaces = surfaces_for(1);
+      render_ceiling(content, size, shades, surfaces);
+      render_floor(content, size, shades, surfaces);
+      render_walls(content, cast);
+      break;
+    }
+  }
+
+  return content;
+}
+
+}  // namespace
+
+namespace textray {
+
+// ==========================================================================
+// PANORAMA IMPLEMENTATION STRUCTURE
+// ==========================================================================
+struct panorama::impl
+{
+  // The walls seen in each sampled direction are cast only when a view
+  // first needs them.
+  struct sample
+  {
+    ray_hits hits{};
+    bool cast{false};
+  };
+
+  // The panorama is only used when its resolution is at most this many
+  // times that of the view, beyond which filling it would cost far more
+  // than the views that it saves.  This happens only for very narrow
+  // fields of view, which a rotation of any size soon leaves entirely.
+  static constexpr double max_samples_per_column = 16;
+
+  // Braille casts a ray for each of the two columns of dots in a cell, more
+  // than any other render mode.
+  static constexpr std::size_t max_columns_per_cell = 2;
+
+  // ======================================================================
+  // CAST_WALLS
+  // ======================================================================
+  wall_pass cast_walls(
+      terminalpp::extent size,
+      int columns,
+      int texel_rows_per_cell,
+      floorplan const &plan,
+      shade_table const &shades,
+      vector2d const &position,
+      double heading,
+      double fov,
+      render_options const &options)
+  {
+    // The angle between the rays of adjacent columns is smallest at the
+    // edges of the view, where it is sin(fov) / columns.  The panorama is
+    // sampled at least that finely, so that no two columns of the view
+    // ever share a sample.
+    auto const required_samples = std::ceil(2 * M_PI * columns / std::sin(fov));
+
+    if (columns <= 0 || size.width_ <= 0 || size.height_ <= 0
+        || required_samples > max_samples_per_column * columns)
+    {
+      return ::cast_walls(
+          size,
+          columns,
+          texel_rows_per_cell,
+          plan,
+          shades,
+          position,
+          heading,
+          fov,
+          options);
+    }
+
+    TEXTRAY_TRACE_SPAN("cast_walls panorama");
+
+    auto const sample_count = static_cast<long>(required_samples);
+    auto const samples_per_radian = sample_count / (2 * M_PI);
+
+    auto const precision = options.precision;
+
+    if (&plan != plan_ || position != position_ || precision != precision_
+        || static_cast<std::size_t>(sample_count) != samples_.size())
+    {
+      plan_ = &plan;
+      position_ = position;
+      precision_ = precision;
+      samples_.assign(sample_count, sample{});
+    }
+
+    if (columns != columns_ || fov != fov_)
+    {
+      build_column_tables(columns, fov, samples_per_radian);
+    }
+
+    // The heading is resampled to the nearest direction in the panorama,
+    // and each column is then a fixed number of samples away from it.
+    auto const heading_index = std::lround(heading * samples_per_radian);
+    double const fov_scale_y = vertical_fov_scale(size, fov);
+    auto const tallest = options.summary->tallest_wall;
+    wall_shading shading(shades, options.lighting);
+    wall_pass pass;
+    pass.columns.resize(columns);
+
+    for (int x = 0; x < columns; ++x)
+    {
+      auto const index =
+          ((heading_index + column_offsets_[x]) % sample_count + sample_count)
+          % sample_count;
+
+      auto hits = sample_hits(
+          plan, position, index, samples_per_radian, precision, tallest);
+
+      for (int layer = 0; layer < hits.count; ++layer)
+      {
+        auto &hit = hits.layers[layer];
+        hit.perp_distance = hit.distance * column_cosines_[x];
+      }
+
+      add_wall_spans(
+          pass, x, hits, size, fov_scale_y, texel_rows_per_cell, shading);
+    }
+
+    return pass;
+  }
+
+  // ======================================================================
+  // BUILD_COLUMN_TABLES
+  // ======================================================================
+  // Finds, for each column of the view, the offset of its ray from the
+  // heading in samples, and the cosine of that offset, which projects the
+  // distance along the ray onto the heading.
+  void build_column_tables(int columns, double fov, double samples_per_radian)
+  {
+    columns_ = columns;
+    fov_ = fov;
+    column_offsets_.resize(columns);
+    column_cosines_.resize(columns);
+
+    double const tan_half_fov = tan(fov / 2);
+
+    for (int x = 0; x < columns; ++x)
+    {
+      double const camera_x = 2 * (x + 0.5) / columns - 1;
+      auto const offset =
+          std::lround(-std::atan(camera_x * tan_half_fov) * samples_per_radian);
+
+      column_offsets_[x] = offset;
+      column_cosines_[x] = std::cos(offset / samples_per_radian);
+    }
+  }
+
+  // ======================================================================
+  // SAMPLE_HITS
+  // ======================================================================
+  // Since a panorama serves views of any height, its rays are cast as if
+  // for a view without a top.
+  ray_hits const &sample_hits(
+      floorplan const &plan,
+      vector2d const &position,
+      long index,
+      double samples_per_radian,
+      render_precision precision,
+      double tallest)
+  {
+    auto &sample = samples_[index];
+
+    if (!sample.cast)
+    {
+      auto const ray = vector2d::from_angle(index / samples_per_radian);
+      sample.hits = ::cast_ray(plan, position, ray, precision, tallest);
+      sample.cast = true;
+    }
+
+    return sample.hits;
+  }
+
+  floorplan const *plan_{nullptr};
+  vector2d position_;
+  render_precision precision_{render_precision::double_precision};
+  std::vector<sample> samples_;
+
+  int columns_{0};
+  double fov_{0};
+  std::vector<long> column_offsets_;
+  std::vector<double> column_cosines_;
+
+  // The floor and ceiling rows of the last view served, which are kept
+  // here whether or not its walls could be resampled from the panorama.
+  surface_rows surface_rows_;
+};
+
+// ==========================================================================
+// PANORAMA CONSTRUCTOR
+// ==========================================================================
+panorama::panorama() : pimpl_(boost::make_unique<impl>())
+{
+}
+
+// ==========================================================================
+// PANORAMA MOVE CONSTRUCTOR
+// ==========================================================================
+panorama::panorama(panorama &&other) noexcept = default;
+
+// ==========================================================================
+// PANORAMA DESTRUCTOR
+// ==========================================================================
+panorama::~panorama() = default;
+
+// ==========================================================================
+// PANORAMA MOVE ASSIGNMENT
+// ==========================================================================
+panorama &panorama::operator=(panorama &&other) noexcept = default;
+
+// ==========================================================================
+// INVALIDATE
+// ==========================================================================
+void panorama::invalidate()
+{
+  pimpl_->samples_.clear();
+}
+
+// ==========================================================================
+// MAX_BYTES_PER_CELL_COLUMN
+// ==========================================================================
+std::size_t panorama::max_bytes_per_cell_column()
+{
+  // Each column of a view may need up to the maximum number of samples,
+  // each of which holds every layer of walls that its ray may hit, as well
+  // as its entries in the column tables.
+  constexpr auto bytes_per_column =
+      (static_cast<std::size_t>(impl::max_samples_per_column)
+       * sizeof(impl::sample))
+      + sizeof(long) + sizeof(double);
+
+  return impl::max_columns_per_cell * bytes_per_column;
+}
+
+// ==========================================================================
+// SUMMARISE_FLOORPLAN
+// ==========================================================================
+floorplan_summary summarise_floorplan(floorplan const &plan)
+{
+  floorplan_summary summary;
+
+  for (auto const &row : plan)
+  {
+    for (auto const &tile : row)
+    {
+      if (tile.fill.glyph_.character_ != 0)
+      {
+        summary.tallest_wall = std::max(summary.tallest_wall, tile.height);
+      }
+
+      if (tile.floor_surface || tile.ceiling_surface)
+      {
+        summary.surfaces_textured = true;
+      }
+    }
+  }
+
+  return summary;
+}
+
+// ==========================================================================
+// MAKE_SHADE_TABLE
+// ==========================================================================
+shade_table make_shade_table(
+    floorplan const &plan, colour_depth depth, int bands)
+{
+  shade_table shades{depth, bands};
+  shades.add(ceiling_colour);
+  shades.add(floor_colour);
+
+  for (auto const &row : plan)
+  {
+    for (auto const &tile : row)
+    {
+      shades.add(wall_colour(tile));
+
+      for (auto const *surface :
+           {tile.surface.get(),
+            tile.floor_surface.get(),
+            tile.ceiling_surface.get()})
+      {
+        if (surface != nullptr)
+        {
+          for (auto const &colour : surface->palette())
+          {
+            shades.add(colour);
+          }
+        }
+      }
+    }
+  }
+
+  return shades;
+}
+
+// ==========================================================================
+// RENDER_FRAME
+// ==========================================================================
+std::vector<terminalpp::string> render_frame(
+    terminalpp::extent size,
+    floorplan const &plan,
+    shade_table const &shades,
+    vector2d const &position,
+    double heading,
+    double fov,
+    render_options const &options)
+{
+  // FoV has to be between 0 and 180 degrees (exclusive).
+  assert(fov > 0.0001);
+  assert(fov < M_PI - 0.0001);
+
+  // Without a panorama, nothing is kept from one frame to the next.  A
+  // floorplan that has not been summarised is summarised for this frame.
+  surface_rows rows;
+  auto const summary = options.summary != nullptr
+                           ? *options.summary
+                           : summarise_floorplan(plan);
+  auto summarised = options;
+  summarised.summary = &summary;
+
+  return render_view(
+      size,
+      plan,
+      shades,
+      position,
+      heading,
+      fov,
+      summarised,
+      rows,
+      [&](int columns, int texel_rows_per_cell)
+      {
+        return cast_walls(
+            size,
+            columns,
+            texel_rows_per_cell,
+            plan,
+            shades,
+            position,
+            heading,
+            fov,
+            summarised);
+      });
+}
+
+// ==========================================================================
+// RENDER_FRAME
+// ==========================================================================
+std::vector<terminalpp::string> render_frame(
+    terminalpp::extent size,
+    floorplan const &plan,
+    shade_table const &shades,
+    vector2d const &position,
+    double heading,
+    double fov,
+    render_options const &options,
+    panorama &cache)
+{
+  assert(fov > 0.0001);
+  assert(fov < M_PI - 0.0001);
+
+  auto const summary = options.summary != nullptr
+                           ? *options.summary
+                           : summarise_floorplan(plan);
+  auto summarised = options;
+  summarised.summary = &summary;
+
+  return render_view(
+      size,
+      plan,
+      shades,
+      position,
+      heading,
+      fov,
+      summarised,
+      cache.pimpl_->surface_rows_,
+      [&](int columns, int texel_rows_per_cell)
+      {
+        return cache.pimpl_->cast_walls(
+            size,
+            columns,
+            texel_rows_per_cell,
+            plan,
+            shades,
+            position,
+            heading,
+            fov,
+            summarised);
+      });
+}
+
+}  // namespace textray
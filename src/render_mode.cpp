@@ -0,0 +1,23 @@
+#include "render_mode.hpp"
+
+namespace textray {
+
+// ==========================================================================
+// NEXT_RENDER_MODE
+// ==========================================================================
+render_mode next_render_mode(render_mode mode)
+{
+  switch (mode)
+  {
+    case render_mode::cells:
+      return render_mode::half_blocks;
+
+    case render_mode::half_blocks:
+      return render_mode::braille;
+
+    default:
+      return render_mode::cells;
+  }
+}
+
+}  // namespace textray
@@ -0,0 +1,47 @@
+#include "render_precision.hpp"
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace textray {
+
+namespace {
+
+constexpr std::pair<render_precision, std::string_view> precision_names[] = {
+    {render_precision::double_precision, "double"},
+    {render_precision::single_precision, "float"},
+    {render_precision::fixed_point, "fixed"},
+};
+
+}  // namespace
+
+// ==========================================================================
+// RENDER_PRECISION_FROM_NAME
+// ==========================================================================
+std::optional<render_precision> render_precision_from_name(
+    std::string_view name)
+{
+  auto const *entry = std::find_if(
+      std::begin(precision_names),
+      std::end(precision_names),
+      [name](auto const &entry) { return entry.second == name; });
+
+  return entry == std::end(precision_names)
+             ? std::nullopt
+             : std::optional<render_precision>{entry->first};
+}
+
+// ==========================================================================
+// RENDER_PRECISION_NAME
+// ==========================================================================
+std::string_view render_precision_name(render_precision precision)
+{
+  auto const *entry = std::find_if(
+      std::begin(precision_names),
+      std::end(precision_names),
+      [precision](auto const &entry) { return entry.first == precision; });
+
+  return entry == std::end(precision_names) ? "double" : entry->second;
+}
+
+}  // namespace textray
@@ -0,0 +1,183 @@
+// textray_replay: replays recordings of clients' input, made by running
+// textray with --record-dir, through the client, UI and renderer as fast
+// as possible, and reports the work that was done.
+
+#include "client.hpp"
+#include "connection.hpp"
+#include "metrics.hpp"
+#include "recording.hpp"
+#include "settings.hpp"
+#include <boost/asio/io_context.hpp>
+#include <boost/format.hpp>
+#include <boost/make_unique.hpp>
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace po = boost::program_options;
+
+namespace {
+
+// ==========================================================================
+// REPORT
+// ==========================================================================
+void report(
+    std::ostream &out,
+    std::string const &name,
+    textray::client_metrics const &metrics)
+{
+  out << boost::format(
+             "%s: %d input tokens, %d ticks, %d frames (%d dropped), %d "
+             "bytes; render p50=%.3fms p99=%.3fms\n")
+             % name % metrics.input_tokens % metrics.ticks % metrics.frames
+             % metrics.frames_dropped % metrics.bytes_written
+             % (metrics.render_time_us.quantile(0.5) / 1000.0)
+             % (metrics.render_time_us.quantile(0.99) / 1000.0);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+  std::vector<std::string> recordings;
+  unsigned int tick_interval_ms = 0;
+  unsigned int repeat = 1;
+
+  po::options_description description("Available options");
+  description.add_options()("help,h", "show this help message")(
+      "recording,r",
+      po::value<std::vector<std::string>>(&recordings),
+      "recording to replay")(
+      "tick,k",
+      po::value<unsigned int>(&tick_interval_ms)->default_value(0),
+      "interval of each client's simulation tick in milliseconds")(
+      "repeat,n",
+      po::value<unsigned int>(&repeat)->default_value(1),
+      "number of times to replay each recording");
+
+  po::positional_options_description pos_description;
+  pos_description.add("recording", -1);
+
+  try
+  {
+    po::variables_map vm;
+    po::store(
+        po::command_line_parser(argc, argv)
+            .options(description)
+            .positional(pos_description)
+            .run(),
+        vm);
+
+    po::notify(vm);
+
+    if (vm.count("help") != 0)
+    {
+      throw po::error("");
+    }
+    else if (recordings.empty())
+    {
+      throw po::error("At least one recording must be specified");
+    }
+  }
+  catch (po::error &err)
+  {
+    if (strlen(err.what()) == 0)
+    {
+      std::cout << boost::format("USAGE: %s <recording>...|<options>\n")
+                       % argv[0]
+                << description << std::endl;
+
+      return EXIT_SUCCESS;
+    }
+
+    std::cerr << boost::format(
+                     "ERROR: %s\n\nUSAGE: %s <recording>...|<options>\n")
+                     % err.what() % argv[0]
+              << description << std::endl;
+
+    return EXIT_FAILURE;
+  }
+
+  textray::settings config;
+  config.tick_interval = std::chrono::milliseconds{tick_interval_ms};
+
+  // Everything runs on a single thread, so that the order in which each
+  // client's input, ticks and frames are interleaved is the same on every
+  // run.
+  boost::asio::io_context io_context;
+  textray::server_metrics metrics;
+  std::vector<std::unique_ptr<textray::client>> clients;
+  std::vector<std::pair<std::string, std::shared_ptr<textray::client_metrics>>>
+      results;
+
+  try
+  {
+    for (auto const &recording : recordings)
+    {
+      auto const events = textray::load_recording(recording);
+
+      for (unsigned int run = 0; run < repeat; ++run)
+      {
+        auto client_metrics = metrics.make_client_metrics();
+        results.emplace_back(recording, client_metrics);
+
+        clients.push_back(boost::make_unique<textray::client>(
+            textray::connection(
+                textray::make_replay_endpoint(io_context, events)),
+            io_context,
+            nullptr,
+            config,
+            client_metrics,
+            [](textray::client const &) {},
+            [] {}));
+      }
+    }
+  }
+  catch (std::exception const &ex)
+  {
+    std::cerr << "ERROR: " << ex.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  auto const wall_start = std::chrono::steady_clock::now();
+  auto const cpu_start = std::clock();
+
+  io_context.run();
+
+  auto const cpu_seconds =
+      static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+  auto const wall_seconds = std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - wall_start)
+                                .count();
+
+  clients.clear();
+
+  textray::client_metrics total;
+
+  for (auto const &[name, client_metrics] : results)
+  {
+    report(std::cout, name, *client_metrics);
+
+    total.input_tokens += client_metrics->input_tokens;
+    total.ticks += client_metrics->ticks;
+    total.frames += client_metrics->frames;
+    total.frames_dropped += client_metrics->frames_dropped;
+    total.bytes_written += client_metrics->bytes_written;
+    total.render_time_us.merge(client_metrics->render_time_us);
+  }
+
+  report(std::cout, "total", total);
+
+  std::cout << boost::format(
+                   "wall: %.3fs, cpu: %.3fs, %.1f frames per cpu second\n")
+                   % wall_seconds % cpu_seconds
+                   % (total.frames / std::max(cpu_seconds, 1e-9));
+
+  return EXIT_SUCCESS;
+}
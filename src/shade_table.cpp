@@ -0,0 +1,377 @@
+#include "shade_table.hpp"
+#include "overloaded.hpp"
+#include <terminalpp/palette.hpp>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <map>
+#include <variant>
+
+namespace {
+
+terminalpp::attribute darken_high_colour(
+    terminalpp::high_colour col, double percentage)
+{
+  auto const red_component =
+      terminalpp::ansi::graphics::high_red_component(col.value_);
+  auto const green_component =
+      terminalpp::ansi::graphics::high_green_component(col.value_);
+  auto const blue_component =
+      terminalpp::ansi::graphics::high_blue_component(col.value_);
+
+  auto const darkened_red_component =
+      (static_cast<double>(red_component) * (100 - percentage)) / 100;
+  auto const darkened_green_component =
+      (static_cast<double>(green_component) * (100 - percentage)) / 100;
+  auto const darkened_blue_component =
+      (static_cast<double>(blue_component) * (100 - percentage)) / 100;
+
+  return {terminalpp::high_colour(
+      static_cast<terminalpp::byte>(darkened_red_component),
+      static_cast<terminalpp::byte>(darkened_green_component),
+      static_cast<terminalpp::byte>(darkened_blue_component))};
+}
+
+terminalpp::attribute darken_greyscale_colour(
+    terminalpp::greyscale_colour col, double percentage)
+{
+  auto const greyscale_component =
+      terminalpp::ansi::graphics::greyscale_component(col.shade_);
+  auto const darkened_greyscale_component = static_cast<terminalpp::byte>(
+      (static_cast<int>(greyscale_component) * (100 - percentage)) / 100);
+
+  return {terminalpp::greyscale_colour{darkened_greyscale_component}};
+}
+
+terminalpp::attribute darken_true_colour(
+    terminalpp::true_colour col, double percentage)
+{
+  auto const reduction = (256 * percentage) / 100;
+  auto const darkened_red_component =
+      std::max(static_cast<double>(col.red_) - reduction, double{0});
+  auto const darkened_green_component =
+      std::max(static_cast<double>(col.green_) - reduction, double{0});
+  auto const darkened_blue_component =
+      std::max(static_cast<double>(col.blue_) - reduction, double{0});
+
+  return {terminalpp::true_colour{
+      static_cast<terminalpp::byte>(darkened_red_component),
+      static_cast<terminalpp::byte>(darkened_green_component),
+      static_cast<terminalpp::byte>(darkened_blue_component)}};
+}
+
+terminalpp::true_colour low_colour_to_true_colour(terminalpp::low_colour col)
+{
+  static auto const low_to_high_mapping =
+      std::map<terminalpp::low_colour, terminalpp::true_colour>{
+          {terminalpp::graphics::colour::black,
+           terminalpp::true_colour{0, 0, 0}},
+          {terminalpp::graphics::colour::red,
+           terminalpp::true_colour{0xB8, 0x25, 0x0F}},
+          {terminalpp::graphics::colour::green,
+           terminalpp::true_colour{0, 0xFF, 0}},
+          {terminalpp::graphics::colour::yellow,
+           terminalpp::true_colour{0xFF, 0xFF, 0}},
+          {terminalpp::graphics::colour::blue,
+           terminalpp::true_colour{0, 0, 0xFF}},
+          {terminalpp::graphics::colour::magenta,
+           terminalpp::true_colour{0xFF, 0, 0xFF}},
+          {terminalpp::graphics::colour::cyan,
+           terminalpp::true_colour{0, 0xFF, 0xFF}},
+          {terminalpp::graphics::colour::white,
+           terminalpp::true_colour{0xEE, 0xEE, 0xEE}},
+          {terminalpp::graphics::colour::default_,
+           terminalpp::true_colour{0, 0, 0}}};
+
+  auto const mapping = low_to_high_mapping.find(col);
+  return mapping == low_to_high_mapping.end() ? terminalpp::true_colour{0, 0, 0}
+                                              : mapping->second;
+}
+
+terminalpp::attribute darken_low_colour(
+    terminalpp::low_colour col, double percentage)
+{
+  if (col == terminalpp::graphics::colour::white)
+  {
+    return darken_greyscale_colour(
+        terminalpp::greyscale_colour{23}, percentage);
+  }
+  else
+  {
+    return darken_true_colour(low_colour_to_true_colour(col), percentage);
+  }
+}
+
+terminalpp::attribute darken_colour(terminalpp::colour col, double percentage)
+{
+  return std::visit(
+      overloaded{
+          [percentage](terminalpp::low_colour const &col)
+          { return darken_low_colour(col, percentage); },
+          [percentage](terminalpp::high_colour const &col)
+          { return darken_high_colour(col, percentage); },
+          [percentage](terminalpp::greyscale_colour const &col)
+          { return darken_greyscale_colour(col, percentage); },
+          [percentage](terminalpp::true_colour const &col)
+          { return darken_true_colour(col, percentage); }},
+      col.value_);
+}
+
+// The intensities of the six steps of each component of the colour cube
+// in the 256-colour palette.
+constexpr std::array<int, 6> colour_cube_steps = {0, 95, 135, 175, 215, 255};
+
+// The intensities of the 24 steps of the greyscale ramp in the 256-colour
+// palette are 8, 18, ..., 238.
+constexpr int greyscale_value(int shade)
+{
+  return 8 + (10 * shade);
+}
+
+terminalpp::true_colour to_true_colour(terminalpp::colour const &col)
+{
+  return std::visit(
+      overloaded{
+          [](terminalpp::low_colour const &col)
+          { return low_colour_to_true_colour(col); },
+          [](terminalpp::high_colour const &col)
+          {
+            return terminalpp::true_colour{
+                static_cast<terminalpp::byte>(
+                    colour_cube_steps[terminalpp::ansi::graphics::
+                                          high_red_component(col.value_)]),
+                static_cast<terminalpp::byte>(
+                    colour_cube_steps[terminalpp::ansi::graphics::
+                                          high_green_component(col.value_)]),
+                static_cast<terminalpp::byte>(
+                    colour_cube_steps[terminalpp::ansi::graphics::
+                                          high_blue_component(col.value_)])};
+          },
+          [](terminalpp::greyscale_colour const &col)
+          {
+            auto const value =
+                static_cast<terminalpp::byte>(greyscale_value(col.shade_));
+            return terminalpp::true_colour{value, value, value};
+          },
+          [](terminalpp::true_colour const &col) { return col; }},
+      col.value_);
+}
+
+int distance_squared(terminalpp::true_colour lhs, terminalpp::true_colour rhs)
+{
+  auto const red = int{lhs.red_} - int{rhs.red_};
+  auto const green = int{lhs.green_} - int{rhs.green_};
+  auto const blue = int{lhs.blue_} - int{rhs.blue_};
+  return (red * red) + (green * green) + (blue * blue);
+}
+
+int luminance(terminalpp::true_colour col)
+{
+  return static_cast<int>(
+      (0.2126 * col.red_) + (0.7152 * col.green_) + (0.0722 * col.blue_));
+}
+
+terminalpp::greyscale_colour nearest_greyscale_colour(int value)
+{
+  return terminalpp::greyscale_colour{static_cast<terminalpp::byte>(
+      std::clamp((value - 3) / 10, 0, 23))};
+}
+
+int nearest_colour_cube_step(int value)
+{
+  return value < 48 ? 0 : value < 115 ? 1 : (value - 35) / 40;
+}
+
+terminalpp::attribute quantise_to_high_colour(terminalpp::true_colour col)
+{
+  auto const red_step = nearest_colour_cube_step(col.red_);
+  auto const green_step = nearest_colour_cube_step(col.green_);
+  auto const blue_step = nearest_colour_cube_step(col.blue_);
+
+  auto const cube_colour = terminalpp::true_colour{
+      static_cast<terminalpp::byte>(colour_cube_steps[red_step]),
+      static_cast<terminalpp::byte>(colour_cube_steps[green_step]),
+      static_cast<terminalpp::byte>(colour_cube_steps[blue_step])};
+
+  auto const grey = nearest_greyscale_colour(
+      (int{col.red_} + int{col.green_} + int{col.blue_}) / 3);
+  auto const grey_value = static_cast<terminalpp::byte>(
+      greyscale_value(grey.shade_));
+  auto const grey_colour =
+      terminalpp::true_colour{grey_value, grey_value, grey_value};
+
+  if (distance_squared(col, grey_colour) < distance_squared(col, cube_colour))
+  {
+    return {grey};
+  }
+
+  return {terminalpp::high_colour(
+      static_cast<terminalpp::byte>(red_step),
+      static_cast<terminalpp::byte>(green_step),
+      static_cast<terminalpp::byte>(blue_step))};
+}
+
+terminalpp::attribute quantise_to_low_colour(terminalpp::true_colour col)
+{
+  // The conventional (xterm) palette of the 8 normal colours followed by
+  // the 8 bright colours, which are selected using bold intensity.
+  static constexpr std::array<terminalpp::true_colour, 16> palette = {{
+      {0x00, 0x00, 0x00},
+      {0xCD, 0x00, 0x00},
+      {0x00, 0xCD, 0x00},
+      {0xCD, 0xCD, 0x00},
+      {0x00, 0x00, 0xEE},
+      {0xCD, 0x00, 0xCD},
+      {0x00, 0xCD, 0xCD},
+      {0xE5, 0xE5, 0xE5},
+      {0x7F, 0x7F, 0x7F},
+      {0xFF, 0x00, 0x00},
+      {0x00, 0xFF, 0x00},
+      {0xFF, 0xFF, 0x00},
+      {0x5C, 0x5C, 0xFF},
+      {0xFF, 0x00, 0xFF},
+      {0x00, 0xFF, 0xFF},
+      {0xFF, 0xFF, 0xFF},
+  }};
+
+  auto const *nearest = std::min_element(
+      palette.begin(),
+      palette.end(),
+      [col](auto const &lhs, auto const &rhs)
+      { return distance_squared(col, lhs) < distance_squared(col, rhs); });
+  auto const index = static_cast<int>(nearest - palette.begin());
+
+  auto attr = terminalpp::attribute{terminalpp::low_colour{
+      static_cast<terminalpp::graphics::colour>(index % 8)}};
+
+  if (index >= 8)
+  {
+    attr.intensity_ = terminalpp::graphics::intensity::bold;
+  }
+
+  return attr;
+}
+
+// Returns the representative darkness of the band that contains the given
+// percentage.  This is the middle of the band, so that neither the first
+// band is left undarkened nor the last band black.
+double banded_percentage(std::size_t percentage, int bands)
+{
+  if (bands <= 0)
+  {
+    return static_cast<double>(percentage);
+  }
+
+  auto const band = std::min(
+      static_cast<int>(percentage) * bands / 100, bands - 1);
+
+  return ((band + 0.5) * 100) / bands;
+}
+
+terminalpp::attribute quantise(
+    terminalpp::attribute const &attr, textray::colour_depth depth)
+{
+  auto const &col = attr.foreground_colour_;
+
+  switch (depth)
+  {
+    case textray::colour_depth::high_colour:
+      // Anything that is not already representable in the 256-colour
+      // palette is mapped onto either its colour cube or its greyscale
+      // ramp.
+      return std::holds_alternative<terminalpp::true_colour>(col.value_)
+                 ? quantise_to_high_colour(
+                     std::get<terminalpp::true_colour>(col.value_))
+                 : attr;
+
+    case textray::colour_depth::low_colour:
+      return std::holds_alternative<terminalpp::low_colour>(col.value_)
+                 ? attr
+                 : quantise_to_low_colour(to_true_colour(col));
+
+    case textray::colour_depth::greyscale:
+      return {nearest_greyscale_colour(luminance(to_true_colour(col)))};
+
+    default:
+      return attr;
+  }
+}
+
+}  // namespace
+
+namespace textray {
+
+// ==========================================================================
+// CONSTRUCTOR
+// ==========================================================================
+shade_table::shade_table(colour_depth depth, int bands)
+  : depth_(depth), bands_(bands)
+{
+}
+
+// ==========================================================================
+// DEPTH
+// ==========================================================================
+colour_depth shade_table::depth() const
+{
+  return depth_;
+}
+
+// ==========================================================================
+// BANDS
+// ==========================================================================
+int shade_table::bands() const
+{
+  return bands_;
+}
+
+// ==========================================================================
+// ADD
+// ==========================================================================
+std::size_t shade_table::add(terminalpp::colour const &base)
+{
+  auto const existing_row = std::find(bases_.begin(), bases_.end(), base);
+
+  if (existing_row != bases_.end())
+  {
+    return static_cast<std::size_t>(existing_row - bases_.begin());
+  }
+
+  bases_.push_back(base);
+
+  for (std::size_t percentage = 0; percentage < shades_per_row; ++percentage)
+  {
+    shades_.push_back(quantise(
+        darken_colour(base, banded_percentage(percentage, bands_)), depth_));
+  }
+
+  return bases_.size() - 1;
+}
+
+// ==========================================================================
+// ROW_OF
+// ==========================================================================
+std::size_t shade_table::row_of(terminalpp::colour const &base) const
+{
+  auto const row = std::find(bases_.begin(), bases_.end(), base);
+  assert(row != bases_.end());
+
+  return static_cast<std::size_t>(row - bases_.begin());
+}
+
+// ==========================================================================
+// SHADE
+// ==========================================================================
+terminalpp::attribute const &shade_table::shade(
+    std::size_t row, double darkness_percentage) const
+{
+  auto const column = static_cast<std::size_t>(std::clamp(
+      std::lround(darkness_percentage),
+      0L,
+      static_cast<long>(shades_per_row - 1)));
+
+  return shades_[(row * shades_per_row) + column];
+}
+
+}  // namespace textray
@@ -0,0 +1,182 @@
+#include "tcp_listener.hpp"
+#include <serverpp/tcp_socket.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/v6_only.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/make_unique.hpp>
+#include <boost/system/system_error.hpp>
+#include <chrono>
+#include <utility>
+
+namespace textray {
+
+namespace {
+
+// After an accept fails for any reason other than the listener being shut
+// down, such as the process having run out of file descriptors, accepting
+// is retried only after this long, rather than spinning on the error.
+constexpr auto accept_retry_delay = std::chrono::milliseconds(100);
+
+#ifdef SO_REUSEPORT
+// ==========================================================================
+// REUSE_PORT
+// ==========================================================================
+// The SO_REUSEPORT socket option, as a SettableSocketOption.
+class reuse_port
+{
+ public:
+  explicit reuse_port(bool enabled) : value_(enabled ? 1 : 0)
+  {
+  }
+
+  template <class Protocol>
+  [[nodiscard]] int level(Protocol const &) const
+  {
+    return SOL_SOCKET;
+  }
+
+  template <class Protocol>
+  [[nodiscard]] int name(Protocol const &) const
+  {
+    return SO_REUSEPORT;
+  }
+
+  template <class Protocol>
+  [[nodiscard]] int const *data(Protocol const &) const
+  {
+    return &value_;
+  }
+
+  template <class Protocol>
+  [[nodiscard]] std::size_t size(Protocol const &) const
+  {
+    return sizeof(value_);
+  }
+
+ private:
+  int value_;
+};
+#endif
+
+}  // namespace
+
+// ==========================================================================
+// TCP_LISTENER::IMPLEMENTATION STRUCTURE
+// ==========================================================================
+struct tcp_listener::impl
+{
+  // ======================================================================
+  // CONSTRUCTOR
+  // ======================================================================
+  impl(
+      boost::asio::io_context &io_context,
+      serverpp::port_identifier port,
+      connection_handler handler)
+    : acceptor_(io_context),
+      retry_timer_(io_context),
+      handler_(std::move(handler))
+  {
+    auto const endpoint =
+        boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v6(), port);
+
+    acceptor_.open(endpoint.protocol());
+    acceptor_.set_option(boost::asio::ip::v6_only(false));
+    acceptor_.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+
+#ifdef SO_REUSEPORT
+    acceptor_.set_option(reuse_port(true));
+#else
+    throw boost::system::system_error(
+        boost::asio::error::operation_not_supported,
+        "SO_REUSEPORT is not supported on this platform");
+#endif
+
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+
+    accept_next();
+  }
+
+  // ======================================================================
+  // SHUTDOWN
+  // ======================================================================
+  void shutdown()
+  {
+    boost::system::error_code ec;
+    acceptor_.close(ec);
+    retry_timer_.cancel();
+  }
+
+ private:
+  // ======================================================================
+  // ACCEPT_NEXT
+  // ======================================================================
+  void accept_next()
+  {
+    acceptor_.async_accept(
+        [this](
+            boost::system::error_code const &ec,
+            boost::asio::ip::tcp::socket socket)
+        {
+          if (!acceptor_.is_open())
+          {
+            return;
+          }
+
+          if (ec)
+          {
+            retry_accept();
+            return;
+          }
+
+          handler_(serverpp::tcp_socket{std::move(socket)});
+          accept_next();
+        });
+  }
+
+  // ======================================================================
+  // RETRY_ACCEPT
+  // ======================================================================
+  void retry_accept()
+  {
+    retry_timer_.expires_after(accept_retry_delay);
+    retry_timer_.async_wait(
+        [this](boost::system::error_code const &ec)
+        {
+          if (!ec && acceptor_.is_open())
+          {
+            accept_next();
+          }
+        });
+  }
+
+  boost::asio::ip::tcp::acceptor acceptor_;
+  boost::asio::steady_timer retry_timer_;
+  connection_handler handler_;
+};
+
+// ==========================================================================
+// CONSTRUCTOR
+// ==========================================================================
+tcp_listener::tcp_listener(
+    boost::asio::io_context &io_context,
+    serverpp::port_identifier port,
+    connection_handler handler)
+  : pimpl_(boost::make_unique<impl>(io_context, port, std::move(handler)))
+{
+}
+
+// ==========================================================================
+// DESTRUCTOR
+// ==========================================================================
+tcp_listener::~tcp_listener() = default;
+
+// ==========================================================================
+// SHUTDOWN
+// ==========================================================================
+void tcp_listener::shutdown()
+{
+  pimpl_->shutdown();
+}
+
+}  // namespace textray
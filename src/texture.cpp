@@ -0,0 +1,224 @@
+#include "texture.hpp"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <utility>
+
+namespace textray {
+
+namespace {
+
+constexpr std::size_t max_palette_size = 256;
+
+// ==========================================================================
+// REDUCE_BLOCK
+// ==========================================================================
+// Returns the texel that stands for a block of texels at the next coarser
+// mip level: one of those of the block's most common colour, which is the
+// earliest in the block to be counted most often.
+texel reduce_block(std::vector<texel const *> const &block)
+{
+  std::array<int, max_palette_size> counts{};
+  texel const *chosen = block.front();
+
+  for (auto const *candidate : block)
+  {
+    if (++counts[candidate->colour] > counts[chosen->colour])
+    {
+      chosen = candidate;
+    }
+  }
+
+  return *chosen;
+}
+
+}  // namespace
+
+// ==========================================================================
+// CONSTRUCTOR
+// ==========================================================================
+texture::texture(
+    std::vector<terminalpp::colour> palette,
+    std::vector<std::vector<texel>> const &rows)
+  : palette_(std::move(palette))
+{
+  if (rows.empty() || rows.front().empty())
+  {
+    throw std::invalid_argument("a texture must have at least one texel");
+  }
+
+  if (palette_.empty() || palette_.size() > max_palette_size)
+  {
+    throw std::invalid_argument(
+        "a texture's palette must have between 1 and 256 colours");
+  }
+
+  auto const width = static_cast<int>(rows.front().size());
+  auto const height = static_cast<int>(rows.size());
+
+  levels_.push_back({width, height, 0});
+  texels_.resize(static_cast<std::size_t>(width) * height);
+
+  for (int y = 0; y < height; ++y)
+  {
+    if (static_cast<int>(rows[y].size()) != width)
+    {
+      throw std::invalid_argument("every row of a texture must be as wide");
+    }
+
+    for (int x = 0; x < width; ++x)
+    {
+      if (rows[y][x].colour >= palette_.size())
+      {
+        throw std::invalid_argument("a texel's colour is not in the palette");
+      }
+
+      texels_[(static_cast<std::size_t>(x) * height) + y] = rows[y][x];
+    }
+  }
+
+  // Each coarser level reduces each block of two by two texels of the
+  // level before it to a single texel, until the texture is a single
+  // texel high.
+  std::vector<texel const *> block;
+
+  while (levels_.back().height > 1)
+  {
+    auto const finer = levels_.back();
+    auto const coarser = mip_level{
+        std::max(finer.width / 2, 1),
+        std::max(finer.height / 2, 1),
+        texels_.size()};
+
+    texels_.resize(
+        coarser.offset
+        + (static_cast<std::size_t>(coarser.width) * coarser.height));
+
+    for (int x = 0; x < coarser.width; ++x)
+    {
+      for (int y = 0; y < coarser.height; ++y)
+      {
+        block.clear();
+
+        for (int fine_x = x * 2;
+             fine_x < std::min(x * 2 + 2, finer.width);
+             ++fine_x)
+        {
+          for (int fine_y = y * 2;
+               fine_y < std::min(y * 2 + 2, finer.height);
+               ++fine_y)
+          {
+            block.push_back(
+                &texels_
+                    [finer.offset
+                     + (static_cast<std::size_t>(fine_x) * finer.height)
+                     + fine_y]);
+          }
+        }
+
+        texels_
+            [coarser.offset + (static_cast<std::size_t>(x) * coarser.height)
+             + y] = reduce_block(block);
+      }
+    }
+
+    levels_.push_back(coarser);
+  }
+}
+
+// ==========================================================================
+// PALETTE
+// ==========================================================================
+std::vector<terminalpp::colour> const &texture::palette() const
+{
+  return palette_;
+}
+
+// ==========================================================================
+// LEVELS
+// ==========================================================================
+std::size_t texture::levels() const
+{
+  return levels_.size();
+}
+
+// ==========================================================================
+// WIDTH
+// ==========================================================================
+int texture::width(std::size_t level) const
+{
+  return levels_[level].width;
+}
+
+// ==========================================================================
+// HEIGHT
+// ==========================================================================
+int texture::height(std::size_t level) const
+{
+  return levels_[level].height;
+}
+
+// ==========================================================================
+// LEVEL_FOR
+// ==========================================================================
+std::size_t texture::level_for(double projected_rows) const
+{
+  std::size_t level = 0;
+
+  while (level + 1 < levels_.size()
+         && levels_[level + 1].height >= projected_rows)
+  {
+    ++level;
+  }
+
+  return level;
+}
+
+// ==========================================================================
+// COLUMN
+// ==========================================================================
+texel const *texture::column(std::size_t level, double u) const
+{
+  auto const &mip = levels_[level];
+  auto const x =
+      std::clamp(static_cast<int>(u * mip.width), 0, mip.width - 1);
+
+  return &texels_[mip.offset + (static_cast<std::size_t>(x) * mip.height)];
+}
+
+// ==========================================================================
+// MAKE_TEXTURE
+// ==========================================================================
+texture make_texture(
+    std::vector<terminalpp::colour> palette,
+    std::vector<std::string> const &glyph_rows,
+    std::vector<std::string> const &colour_rows)
+{
+  if (glyph_rows.size() != colour_rows.size())
+  {
+    throw std::invalid_argument(
+        "a texture must have as many rows of colours as of glyphs");
+  }
+
+  std::vector<std::vector<texel>> rows(glyph_rows.size());
+
+  for (std::size_t y = 0; y < rows.size(); ++y)
+  {
+    if (glyph_rows[y].size() != colour_rows[y].size())
+    {
+      throw std::invalid_argument(
+          "each row of a texture's colours must be as wide as its glyphs");
+    }
+
+    for (std::size_t x = 0; x < glyph_rows[y].size(); ++x)
+    {
+      rows[y].push_back(
+          {terminalpp::glyph(static_cast<terminalpp::byte>(glyph_rows[y][x])),
+           static_cast<std::uint8_t>(colour_rows[y][x] - '0')});
+    }
+  }
+
+  return texture{std::move(palette), rows};
+}
+
+}  // namespace textray
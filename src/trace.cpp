@@ -0,0 +1,158 @@
+#include "trace.hpp"
+
+#ifdef TEXTRAY_WITH_TRACING
+
+#include <boost/format.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace textray::trace {
+
+namespace {
+
+// ==========================================================================
+// RING_BUFFER
+// ==========================================================================
+// The spans recorded by a single thread.  Only the owning thread writes
+// to the buffer, so recording needs no lock; once the buffer is full, the
+// oldest spans are overwritten.  Each field is atomic so that a reader
+// may copy the buffer while it is being written.  A span that is
+// overwritten during the copy may be reported with mixed fields, which is
+// tolerable for diagnostics.
+class ring_buffer
+{
+ public:
+  static constexpr std::size_t capacity = 16384;
+
+  explicit ring_buffer(std::size_t thread_id) : thread_id_(thread_id)
+  {
+  }
+
+  void record(char const *name, std::int64_t start_ns, std::int64_t end_ns)
+  {
+    auto const head = head_.load(std::memory_order_relaxed);
+    auto &entry = entries_[head % capacity];
+
+    entry.name.store(name, std::memory_order_relaxed);
+    entry.start_ns.store(start_ns, std::memory_order_relaxed);
+    entry.duration_ns.store(end_ns - start_ns, std::memory_order_relaxed);
+
+    head_.store(head + 1, std::memory_order_release);
+  }
+
+  void write(std::ostream &out, bool &first) const
+  {
+    auto const head = head_.load(std::memory_order_acquire);
+    auto const begin = head > capacity ? head - capacity : 0;
+
+    for (auto index = begin; index < head; ++index)
+    {
+      auto const &entry = entries_[index % capacity];
+
+      out << (first ? "\n" : ",\n")
+          << boost::format(
+                 R"({"name":"%s","ph":"X","pid":1,"tid":%d,"ts":%.3f,)"
+                 R"("dur":%.3f})")
+                 % entry.name.load(std::memory_order_relaxed) % thread_id_
+                 % (entry.start_ns.load(std::memory_order_relaxed) / 1000.0)
+                 % (entry.duration_ns.load(std::memory_order_relaxed)
+                    / 1000.0);
+      first = false;
+    }
+  }
+
+ private:
+  struct entry
+  {
+    std::atomic<char const *> name{""};
+    std::atomic<std::int64_t> start_ns{0};
+    std::atomic<std::int64_t> duration_ns{0};
+  };
+
+  std::size_t thread_id_;
+  std::array<entry, capacity> entries_;
+  std::atomic<std::size_t> head_{0};
+};
+
+// ==========================================================================
+// REGISTRY
+// ==========================================================================
+// Every thread's buffer, so that all of them can be written out.  Buffers
+// are shared with the registry so that the spans of threads that have
+// exited are not lost.  The lock is only taken when a thread records its
+// first span, and when writing out a trace.
+struct registry
+{
+  std::mutex mutex;
+  std::vector<std::shared_ptr<ring_buffer>> buffers;
+};
+
+registry &the_registry()
+{
+  static registry instance;
+  return instance;
+}
+
+// ==========================================================================
+// THIS_THREAD_BUFFER
+// ==========================================================================
+ring_buffer &this_thread_buffer()
+{
+  thread_local auto const buffer = []
+  {
+    auto &reg = the_registry();
+    auto const lock = std::unique_lock<std::mutex>(reg.mutex);
+    return reg.buffers.emplace_back(
+        std::make_shared<ring_buffer>(reg.buffers.size()));
+  }();
+
+  return *buffer;
+}
+
+// ==========================================================================
+// NANOSECONDS
+// ==========================================================================
+std::int64_t nanoseconds(clock::time_point time)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             time.time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+// ==========================================================================
+// RECORD
+// ==========================================================================
+void record(char const *name, clock::time_point start, clock::time_point end)
+{
+  this_thread_buffer().record(name, nanoseconds(start), nanoseconds(end));
+}
+
+// ==========================================================================
+// WRITE_CHROME_TRACE
+// ==========================================================================
+void write_chrome_trace(std::ostream &out)
+{
+  auto &reg = the_registry();
+  auto const lock = std::unique_lock<std::mutex>(reg.mutex);
+  bool first = true;
+
+  out << R"({"displayTimeUnit":"ms","traceEvents":[)";
+
+  for (auto const &buffer : reg.buffers)
+  {
+    buffer->write(out, first);
+  }
+
+  out << "\n]}\n";
+}
+
+}  // namespace textray::trace
+
+#endif
@@ -32,7 +32,7 @@ ui::ui(
   using namespace terminalpp::literals;  // NOLINT
   auto const status_text = std::vector<terminalpp::string>{
       R"(\<340\>002Movement: asdw.  Rotation: qe)"_ets,
-      R"(\<340\>002Zoom: zx. Reset zoom: c)"_ets};
+      R"(\<340\>002Zoom: zx. Reset: c. Colours: v. Bands: b. Mode: m)"_ets};
 
   auto const fill = R"(\>002 )"_ete;
 
@@ -68,4 +68,54 @@ void ui::set_camera_fov(double fov)
   pimpl_->camera_->set_fov(fov);
 }
 
+void ui::set_camera_colour_depth(colour_depth depth)
+{
+  pimpl_->camera_->set_colour_depth(depth);
+}
+
+void ui::set_camera_shade_bands(int bands)
+{
+  pimpl_->camera_->set_shade_bands(bands);
+}
+
+void ui::set_camera_render_mode(render_mode mode)
+{
+  pimpl_->camera_->set_render_mode(mode);
+}
+
+void ui::set_camera_render_precision(render_precision precision)
+{
+  pimpl_->camera_->set_render_precision(precision);
+}
+
+void ui::set_camera_column_stride(int stride)
+{
+  pimpl_->camera_->set_column_stride(stride);
+}
+
+void ui::set_camera_lighting(std::shared_ptr<lightmap const> lighting)
+{
+  pimpl_->camera_->set_lighting(std::move(lighting));
+}
+
+void ui::set_camera_panorama_enabled(bool enabled)
+{
+  pimpl_->camera_->set_panorama_enabled(enabled);
+}
+
+void ui::set_camera_metrics(std::shared_ptr<client_metrics> metrics)
+{
+  pimpl_->camera_->set_metrics(std::move(metrics));
+}
+
+std::function<camera_frame()> ui::prepare_camera_frame() const
+{
+  return pimpl_->camera_->prepare_frame();
+}
+
+void ui::set_camera_frame(camera_frame frame)
+{
+  pimpl_->camera_->set_frame(std::move(frame));
+}
+
 }  // namespace textray
\ No newline at end of file